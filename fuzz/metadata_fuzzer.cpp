@@ -0,0 +1,31 @@
+#include "MetaData.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+/**
+ * @brief libFuzzer entry for Metadata::decode, the metadata xml comes from
+ * the network so decode has to take any bytes without crashing
+ * @details the input is not null terminated, decode gets the length. Input
+ * that looks like ours and parses is also checked for a stable encoding,
+ * encoding what decode gave must survive another decode and encode byte for
+ * byte, which is what the round trip checks for the containers we make
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  const char *xml = reinterpret_cast<const char *>(data);
+  bool ours = Metadata::isEncodedMetadata(std::string_view(xml, size));
+  MetadataContainer container = Metadata::decode(xml, size);
+  if (!ours) {
+    return 0;
+  }
+  tinyxml2::XMLDocument doc;
+  if (doc.Parse(xml, size) != tinyxml2::XML_SUCCESS) {
+    return 0;
+  }
+  std::string encoded = Metadata::encode(container);
+  if (Metadata::encode(Metadata::decode(encoded)) != encoded) {
+    std::abort();
+  }
+  return 0;
+}
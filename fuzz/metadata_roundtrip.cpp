@@ -0,0 +1,110 @@
+#include "MetaData.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+
+/**
+ * @brief encodes random metadata containers and checks that decode gives the
+ * same values back and that encoding those again gives the same bytes
+ * @details usage: NDIMetadataRoundTrip [iterations] [seed], returns non zero
+ * on the first container that does not survive the round trip
+ */
+namespace {
+template <typename T, typename Generate>
+std::optional<T> maybe(std::mt19937_64 &rng, Generate generate) {
+  if (rng() & 1) {
+    return generate();
+  }
+  return std::nullopt;
+}
+
+MetadataContainer randomContainer(std::mt19937_64 &rng) {
+  std::uniform_int_distribution<int64_t> integer(
+      std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max());
+  std::uniform_real_distribution<double> real(-1e6, 1e6);
+  auto vector = [&]() {
+    return std::array<float, 3>{static_cast<float>(real(rng)),
+                                static_cast<float>(real(rng)),
+                                static_cast<float>(real(rng))};
+  };
+  MetadataContainer container;
+  container.boundingBox = maybe<BoundingBox>(rng, [&]() {
+    BoundingBox box;
+    box.start.x = integer(rng);
+    box.start.y = integer(rng);
+    box.width = integer(rng);
+    box.height = integer(rng);
+    return box;
+  });
+  container.zoom = maybe<Zoom>(rng, [&]() { return real(rng); });
+  container.switchCamera =
+      maybe<SwitchCamera>(rng, [&]() { return (rng() & 1) != 0; });
+  container.aspectRatio = maybe<AspectRatio>(rng, [&]() {
+    return AspectRatio{integer(rng), integer(rng)};
+  });
+  container.accelerometerData = maybe<AccelerometerData>(rng, [&]() {
+    auto v = vector();
+    return AccelerometerData{v[0], v[1], v[2]};
+  });
+  container.gyroscopeData = maybe<GyroscopeData>(rng, [&]() {
+    auto v = vector();
+    return GyroscopeData{v[0], v[1], v[2]};
+  });
+  return container;
+}
+
+template <typename T, typename Equal>
+bool same(const std::optional<T> &a, const std::optional<T> &b, Equal equal) {
+  if (a.has_value() != b.has_value()) {
+    return false;
+  }
+  return !a.has_value() || equal(*a, *b);
+}
+
+template <typename T> bool sameVector(const T &a, const T &b) {
+  return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+bool same(const MetadataContainer &a, const MetadataContainer &b) {
+  return same(a.boundingBox, b.boundingBox,
+              [](const BoundingBox &x, const BoundingBox &y) {
+                return x.start.x == y.start.x && x.start.y == y.start.y &&
+                       x.width == y.width && x.height == y.height;
+              }) &&
+         same(a.zoom, b.zoom, std::equal_to<Zoom>()) &&
+         same(a.switchCamera, b.switchCamera, std::equal_to<SwitchCamera>()) &&
+         same(a.aspectRatio, b.aspectRatio,
+              [](const AspectRatio &x, const AspectRatio &y) {
+                return x.width == y.width && x.height == y.height;
+              }) &&
+         same(a.accelerometerData, b.accelerometerData,
+              sameVector<AccelerometerData>) &&
+         same(a.gyroscopeData, b.gyroscopeData, sameVector<GyroscopeData>);
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? std::atol(argv[1]) : 100000;
+  uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1;
+  std::mt19937_64 rng(seed);
+  for (long i = 0; i < iterations; i++) {
+    MetadataContainer container = randomContainer(rng);
+    std::string xml = Metadata::encode(container);
+    MetadataContainer decoded = Metadata::decode(xml);
+    if (!Metadata::isEncodedMetadata(xml) || !same(container, decoded) ||
+        Metadata::encode(decoded) != xml) {
+      std::cerr << "round trip failed at " << i << " with seed " << seed
+                << ":\n"
+                << xml << std::endl;
+      return 1;
+    }
+  }
+  std::cout << iterations << " containers survived the round trip"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <Processing.NDI.Lib.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "commontypes.hpp"
+
+/**
+ * @brief interleaved 24 bit audio, 3 bytes per sample little endian
+ */
+struct Audio24 {
+  int sampleRate = 0;
+  int channels = 0;
+  int noSamples = 0;
+  std::vector<uint8_t> data;
+  int64_t timestamp = 0;
+};
+
+/**
+ * @brief how the float samples of common_types::Audio are laid out
+ * @details Planar has every channel after each other like the sdk gives them,
+ * Interleaved has the samples of one instant next to each other. The integer
+ * formats Audio16 and Audio24 are always interleaved
+ */
+enum class AudioLayout { Planar, Interleaved };
+
+/**
+ * @brief the audio a receiver delivers
+ * @details channelMap picks the source channel for each output channel, eg.
+ * {1, 0} swaps stereo and {0, 0} duplicates the first channel. A channel that
+ * the source does not have, or -1, is silence. Empty keeps the channels of the
+ * source. The sample rate is never changed
+ */
+struct AudioFormat {
+  AudioLayout layout = AudioLayout::Planar;
+  std::vector<int> channelMap;
+};
+
+/**
+ * @brief conversion kernels between the sdk planar float audio and the
+ * delivered layouts
+ * @details the kernels take the channels as a table of plane pointers so the
+ * channel stride of the sdk frame and the channel map are both handled by the
+ * table, a nullptr plane is silence. The float to integer kernels clamp to
+ * [-1, 1]. SSE2 is used when the compiler targets it, otherwise the same
+ * scalar loops
+ */
+namespace AudioConversion {
+/**
+ * @returns a pointer to the start of each output channel of the frame
+ */
+std::vector<const float *> planes(const NDIlib_audio_frame_v2_t &frame,
+                                  const std::vector<int> &channelMap = {});
+
+/**
+ * @returns a pointer to the start of each output channel of planar audio
+ */
+std::vector<const float *> planes(const common_types::Audio &audio,
+                                  const std::vector<int> &channelMap = {});
+
+/**
+ * @brief copies the planes after each other to dst, which has room for
+ * channels * samples floats
+ */
+void copyPlanar(const float *const *planes, int channels, int samples,
+                float *dst);
+
+/**
+ * @brief interleaves the planes to dst, channels * samples floats
+ */
+void interleave(const float *const *planes, int channels, int samples,
+                float *dst);
+
+/**
+ * @brief interleaves the planes to dst as 16 bit integers
+ */
+void interleaveToInt16(const float *const *planes, int channels, int samples,
+                       int16_t *dst);
+
+/**
+ * @brief interleaves the planes to dst as 24 bit integers, 3 bytes per sample
+ */
+void interleaveToInt24(const float *const *planes, int channels, int samples,
+                       uint8_t *dst);
+
+/**
+ * @brief converts count floats to 16 bit integers, the order is kept
+ */
+void floatToInt16(const float *src, size_t count, int16_t *dst);
+
+/**
+ * @brief converts count floats to 24 bit integers, the order is kept
+ */
+void floatToInt24(const float *src, size_t count, uint8_t *dst);
+
+/**
+ * @brief copies the sdk frame to the audio in the format
+ */
+void toAudio(const NDIlib_audio_frame_v2_t &frame, const AudioFormat &format,
+             common_types::Audio &audio);
+
+/**
+ * @brief converts audio that is in the given layout to interleaved 16 bit
+ */
+void toAudio16(const common_types::Audio &audio, AudioLayout layout,
+               common_types::Audio16 &audio16);
+
+/**
+ * @brief converts audio that is in the given layout to interleaved 24 bit
+ */
+void toAudio24(const common_types::Audio &audio, AudioLayout layout,
+               Audio24 &audio24);
+} // namespace AudioConversion
@@ -1,10 +1,32 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 #include "commontypes.hpp"
 #include "MetaData.hpp"
 
+/**
+ * @brief a value with the ndi timecode it was sent with
+ * @details timecode is in 100 ns units like every timecode in the ndi sdk
+ */
+template <typename T>
+struct TimedSample {
+    int64_t timecode;
+    T value;
+};
+
+/**
+ * @brief sensor samples that came on the metadata channel during a frames exposure
+ */
+struct SensorSamples {
+    std::vector<TimedSample<AccelerometerData>> accelerometer;
+    std::vector<TimedSample<GyroscopeData>> gyroscope;
+};
+
 template <typename T>
 struct DataWithMetadata {
     T data;  // Holds the actual data of type T
     MetadataContainer metadata;  // Holds the metadata
-};
\ No newline at end of file
+    SensorSamples sensors;  // metadata channel samples aligned to this frame, only filled for video
+};
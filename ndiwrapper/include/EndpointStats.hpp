@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief histogram of durations with power of two buckets
+ * @details bucket 0 counts durations under 1 us and bucket i counts
+ * [2^(i-1), 2^i) us, the last one also takes everything longer. Recording is
+ * a few relaxed atomic adds so it can be done on the capture threads, the
+ * snapshot is not atomic as a whole but every counter in it is
+ */
+class LatencyHistogram {
+public:
+  static constexpr size_t kBuckets = 32;
+
+  struct Snapshot {
+    std::array<uint64_t, kBuckets> buckets{};
+    uint64_t count = 0;
+    uint64_t sumUs = 0;
+    uint64_t maxUs = 0;
+
+    /**
+     * @returns the upper bound of bucket in us
+     */
+    static uint64_t bucketUpperBoundUs(size_t bucket);
+
+    /**
+     * @param[in] quantile between 0 and 1, eg. 0.99
+     * @returns the upper bound of the bucket the quantile falls in, 0 if
+     * nothing has been recorded
+     */
+    uint64_t quantileUs(double quantile) const;
+
+    double meanUs() const;
+  };
+
+  void record(std::chrono::nanoseconds duration);
+
+  Snapshot snapshot() const;
+
+private:
+  std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sumUs_{0};
+  std::atomic<uint64_t> maxUs_{0};
+};
+
+/**
+ * @brief the statistics of one sender or receiver at one moment
+ * @details frame counts are what this endpoint received or sent. The dropped
+ * and queued counts come from the sdk and are of the current connection of a
+ * receiver, they start again from zero when the output is switched
+ */
+struct EndpointStatsSnapshot {
+  uint64_t videoFrames = 0;
+  uint64_t audioFrames = 0;
+  uint64_t metadataFrames = 0;
+
+  uint64_t droppedVideoFrames = 0;
+  uint64_t droppedAudioFrames = 0;
+  uint64_t droppedMetadataFrames = 0;
+
+  uint64_t queuedVideoFrames = 0;
+  uint64_t queuedAudioFrames = 0;
+  uint64_t queuedMetadataFrames = 0;
+
+  size_t callbackQueueDepth = 0; // jobs waiting in the callback thread pool
+
+  LatencyHistogram::Snapshot callbackLatency; // from capture to the callback
+  LatencyHistogram::Snapshot copyTime;        // copying the frame out of ndi
+  LatencyHistogram::Snapshot scaleTime;       // scaling for the subscribers
+  LatencyHistogram::Snapshot metadataDecodeTime;
+};
+
+/**
+ * @brief lock free counters of one endpoint, updated on the capture threads
+ * and read with snapshot without stopping anything
+ * @details the endpoints hold it in a shared_ptr so that the callbacks queued
+ * in a shared thread pool can still record their latency after the endpoint
+ * is gone
+ */
+class EndpointStats {
+public:
+  std::atomic<uint64_t> videoFrames{0};
+  std::atomic<uint64_t> audioFrames{0};
+  std::atomic<uint64_t> metadataFrames{0};
+
+  LatencyHistogram callbackLatency;
+  LatencyHistogram copyTime;
+  LatencyHistogram scaleTime;
+  LatencyHistogram metadataDecodeTime;
+
+  /**
+   * @brief the counters, the sdk counts and the queue depth are filled by
+   * the endpoint
+   */
+  EndpointStatsSnapshot snapshot() const;
+};
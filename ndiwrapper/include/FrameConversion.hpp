@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Processing.NDI.Lib.h>
+#include <cstdint>
+
+#include "AugmentedTypes.hpp"
+#include "commontypes.hpp"
+
+/**
+ * @brief copies the sdk frames to the common types, shared by the receivers
+ * @details the video frames must be 4 bytes per pixel, which is what the
+ * receivers ask from the sdk
+ */
+namespace FrameConversion {
+/**
+ * @returns the length of one frame in 100 ns units, the unit of the timecodes
+ */
+int64_t frameDuration(const NDIlib_video_frame_v2_t &frame);
+
+/**
+ * @brief copies the pixels to the image, rows are packed so the image stride
+ * is width * 4 whatever the line stride of the frame is
+ */
+void toImage(const NDIlib_video_frame_v2_t &frame, common_types::Image &image);
+
+/**
+ * @brief copies the pixels and decodes the metadata of the frame if it is made
+ * by Metadata::encode
+ * @param[in] copyPixels with false only the size and the timestamp are set and
+ * the data is left empty
+ */
+DataWithMetadata<common_types::Image>
+toImageWithMetadata(const NDIlib_video_frame_v2_t &frame,
+                    bool copyPixels = true);
+
+/**
+ * @brief copies the samples to the audio as planar float with the channels
+ * packed after each other, whatever the channel stride of the frame is
+ */
+void toAudio(const NDIlib_audio_frame_v2_t &frame, common_types::Audio &audio);
+} // namespace FrameConversion
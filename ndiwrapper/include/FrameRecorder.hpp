@@ -0,0 +1,216 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <Processing.NDI.Lib.h>
+
+#include "MappedFile.hpp"
+
+/**
+ * @brief the on disk layout of a frame recording
+ * @details the file is a header, an index ring of fixed size entries and a
+ * data ring with the payloads. Frame n is in index slot n % indexCapacity and
+ * its data at dataPosition % dataCapacity, positions only grow so a frame is
+ * still intact as long as the data head has not gone a whole lap past it. A
+ * record never wraps around the end of the data ring, the writer skips to the
+ * start instead
+ */
+namespace FrameRecording {
+
+constexpr char kMagic[8] = {'N', 'D', 'I', 'W', 'R', 'E', 'C', '1'};
+constexpr uint32_t kVersion = 1;
+// records start at this alignment in the data ring
+constexpr uint64_t kRecordAlignment = 64;
+
+enum class FrameType : uint32_t { Video = 1, Audio = 2, Metadata = 3 };
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;
+  uint64_t indexCapacity; // entries
+  uint64_t dataCapacity;  // bytes
+  uint64_t indexOffset;   // from the start of the file
+  uint64_t dataOffset;
+  // frames started since the file was created, the next frame gets this seq.
+  // A reader that sees a slot reserved again while copying it drops the copy
+  std::atomic<uint64_t> writeCount;
+  // frames whose data and index entry are complete
+  std::atomic<uint64_t> commitCount;
+  // end of the last record, advanced before the data is written
+  std::atomic<uint64_t> dataHead;
+};
+
+struct IndexEntry {
+  uint64_t seq;
+  int64_t timecode;  // 100 ns units
+  int64_t timestamp; // 100 ns units, 0 or NDIlib_recv_timestamp_undefined
+  uint64_t dataPosition;
+  uint32_t payloadSize; // the video planes, the audio samples or the xml
+  uint32_t metadataSize; // the metadata after the payload, with the nul
+  uint32_t type;         // FrameType
+  uint32_t fourCC;
+  int32_t width;
+  int32_t height;
+  int32_t stride; // line stride of video, channel stride of audio
+  int32_t frameRateN;
+  int32_t frameRateD;
+  int32_t frameFormat;
+  int32_t sampleRate;
+  int32_t channels;
+  int32_t samples;
+  float aspectRatio;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the header counters are shared through the mapping");
+static_assert(sizeof(FileHeader) == 72, "the header is part of the format");
+static_assert(sizeof(IndexEntry) == 88, "the index is part of the format");
+
+/**
+ * @returns the bytes of the planes of the video frame, which depends on the
+ * FourCC, 0 if the format is unknown
+ */
+size_t videoPayloadSize(const NDIlib_video_frame_v2_t &frame);
+
+/**
+ * @brief a recorded frame, the pointers point into the mapping of the file
+ */
+struct FrameView {
+  IndexEntry entry;
+  const uint8_t *payload = nullptr;
+  const char *metadata = nullptr; // nullptr if the frame had none
+
+  FrameType type() const { return static_cast<FrameType>(entry.type); }
+};
+
+} // namespace FrameRecording
+
+/**
+ * @brief writes the received frames to a memory mapped ring file so that the
+ * last frames can be taken out after something has happened
+ * @details the file is created with its full size up front, recording a frame
+ * is a copy of the sdk buffers to the mapping under a mutex and does not
+ * allocate. When the data or the index is full the oldest frames are
+ * overwritten, size the data by the bitrate, eg. 1080p UYVY at 30 fps is about
+ * 124 MB per second. Give it to NDIReceiver::setRecorder to record a receiver
+ */
+class FrameRecorder {
+public:
+  struct Options {
+    size_t dataBytes = size_t(1) << 30;
+    size_t indexEntries = 1 << 16;
+  };
+
+  /**
+   * @brief creates the file, an existing file is overwritten
+   * @throws std::runtime_error if the file can not be created or mapped
+   */
+  FrameRecorder(const std::string &path, const Options &options);
+  explicit FrameRecorder(const std::string &path)
+      : FrameRecorder(path, Options()) {}
+
+  /**
+   * @returns false if the frame does not fit the data ring or the FourCC is
+   * unknown
+   */
+  bool recordVideo(const NDIlib_video_frame_v2_t &frame);
+  bool recordAudio(const NDIlib_audio_frame_v2_t &frame);
+  bool recordMetadata(const NDIlib_metadata_frame_t &frame);
+
+  /**
+   * @brief copies a frame of another recording, used by extract
+   */
+  bool record(const FrameRecording::FrameView &frame);
+
+  /**
+   * @brief starts writing the dirty pages to the disk, the os does it anyway
+   * over time
+   */
+  void flush();
+
+  /**
+   * @returns the frames recorded since the file was created, including the
+   * ones that have been overwritten
+   */
+  uint64_t framesWritten() const;
+
+private:
+  friend class FrameRecordingReader;
+
+  /**
+   * @brief reserves the record, copies the payload and the metadata and
+   * publishes the index entry
+   * @param[in] entry filled except seq, dataPosition and the sizes
+   */
+  bool append(FrameRecording::IndexEntry &entry, const void *payload,
+              size_t payloadSize, const char *metadata);
+
+  /**
+   * @brief marks the newest frame as not there, readers skip it
+   */
+  void discardLast();
+
+  std::string path_;
+  MappedFile file_;
+  FrameRecording::FileHeader *header_;
+  FrameRecording::IndexEntry *index_;
+  uint8_t *data_;
+  // the receiver records video and audio on the frame thread and metadata on
+  // the metadata thread
+  std::mutex writeMutex_;
+};
+
+/**
+ * @brief reads a recording made by FrameRecorder
+ * @details the file is mapped read only and the frames point into it. The
+ * recording can be read while it is being written, but a frame can be
+ * overwritten while it is being looked at, extract checks the frames again
+ * after copying them
+ */
+class FrameRecordingReader {
+public:
+  /**
+   * @throws std::runtime_error if the file is not a recording
+   */
+  explicit FrameRecordingReader(const std::string &path);
+
+  /**
+   * @brief the frames that are still intact with a timecode in
+   * [fromTimecode, toTimecode], oldest first
+   */
+  std::vector<FrameRecording::FrameView>
+  frames(int64_t fromTimecode = INT64_MIN,
+         int64_t toTimecode = INT64_MAX) const;
+
+  /**
+   * @returns the timecode of the newest frame, 0 if there are none
+   */
+  int64_t latestTimecode() const;
+
+  /**
+   * @brief writes the frames of the range to a new recording sized to fit
+   * them
+   * @returns the frames written, -1 if the file could not be created
+   */
+  int64_t extract(int64_t fromTimecode, int64_t toTimecode,
+                  const std::string &outPath) const;
+
+  /**
+   * @returns false if the data of the frame has been overwritten since it was
+   * read
+   */
+  bool intact(const FrameRecording::FrameView &frame) const;
+
+private:
+  MappedFile file_;
+  const FrameRecording::FileHeader *header_;
+  const FrameRecording::IndexEntry *index_;
+  const uint8_t *data_;
+};
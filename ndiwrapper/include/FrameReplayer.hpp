@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameRecorder.hpp"
+#include "NDISender.hpp"
+
+/**
+ * @brief plays a recording made by FrameRecorder through a NDISender
+ * @details the frames are sent straight from the mapping of the file with the
+ * timing of their timecodes, the list of frames is made once when the
+ * replayer is created so playing does not allocate. Video is sent async so
+ * the sdk can compress a frame while the next one is waited for. Create the
+ * sender without clocking, the replayer does the timing. The recording must
+ * not be written while it is played, extract the range first
+ */
+class FrameReplayer {
+public:
+  struct Options {
+    // 2 plays twice as fast, 0 sends as fast as the sender takes the frames
+    double speed = 1.0;
+    bool loop = false;
+    bool video = true;
+    bool audio = true;
+    bool metadata = true;
+    // only frames with a timecode in the range are played
+    int64_t fromTimecode = INT64_MIN;
+    int64_t toTimecode = INT64_MAX;
+  };
+
+  /**
+   * @throws std::runtime_error if the file is not a recording
+   */
+  FrameReplayer(const std::string &path, std::shared_ptr<NDISender> sender,
+                const Options &options);
+  FrameReplayer(const std::string &path, std::shared_ptr<NDISender> sender)
+      : FrameReplayer(path, std::move(sender), Options()) {}
+
+  /**
+   * @brief stops the playing and waits until the sdk has let go of the frames
+   */
+  ~FrameReplayer();
+
+  FrameReplayer(const FrameReplayer &) = delete;
+  FrameReplayer &operator=(const FrameReplayer &) = delete;
+
+  /**
+   * @brief plays on a thread of its own, does nothing if already playing
+   */
+  void start();
+
+  /**
+   * @brief stops the playing at the next frame
+   */
+  void stop();
+
+  /**
+   * @brief plays on the calling thread until the end or until stop is called,
+   * forever with loop
+   */
+  void run();
+
+  bool isRunning() const { return running_; }
+
+  /**
+   * @returns the frames sent since the replayer was created
+   */
+  uint64_t framesSent() const { return framesSent_; }
+
+  /**
+   * @returns the frames in the recording that are played on each round
+   */
+  size_t frameCount() const { return frames_.size(); }
+
+  /**
+   * @returns the time from the first to the last played frame in 100 ns units
+   */
+  int64_t duration() const;
+
+private:
+  /**
+   * @brief sends the frame with its timecode moved by timecodeOffset
+   */
+  void send(const FrameRecording::FrameView &frame, int64_t timecodeOffset);
+
+  FrameRecordingReader reader_;
+  std::shared_ptr<NDISender> sender_;
+  Options options_;
+  std::vector<FrameRecording::FrameView> frames_;
+
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::atomic<bool> stopRequested_{false};
+  std::atomic<uint64_t> framesSent_{0};
+};
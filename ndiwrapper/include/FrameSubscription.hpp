@@ -0,0 +1,123 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "EndpointStats.hpp"
+#include "ThreadPool.hpp"
+#include "Trace.hpp"
+
+/**
+ * @brief how a frame callback wants its frames
+ */
+struct FrameSubscription {
+  // at most this many frames per second, 0 gives every frame
+  double maxFps = 0;
+  // keeps at most one frame queued for the callback and replaces it with the
+  // newer ones, so a slow callback gets the newest frame instead of a backlog
+  bool latestOnly = false;
+};
+
+/**
+ * @brief a frame callback with its subscription, decides which frames it gets
+ * @details select is called once for each frame on the frame thread before the
+ * frame is copied, so a frame nobody selects is not copied or queued at all.
+ * The queued jobs do not point to the subscriber so it can be moved around in
+ * the callback vectors
+ */
+template <typename Frame> class FrameSubscriber {
+public:
+  using Callback = std::function<void(Frame)>;
+  using Clock = std::chrono::steady_clock;
+
+  FrameSubscriber(Callback callback, const FrameSubscription &subscription)
+      : callback_(std::move(callback)),
+        latest_(subscription.latestOnly ? std::make_shared<Latest>()
+                                        : nullptr) {
+    if (subscription.maxFps > 0) {
+      period_ = std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(1.0 / subscription.maxFps));
+    }
+  }
+
+  /**
+   * @brief decides if the frame captured at now goes to this callback
+   * @details a frame up to an eighth of the period early is taken so the jitter
+   * of the source does not drop the rate, and after a pause the rate starts
+   * again from now instead of catching up
+   * @returns the decision, kept for dispatch
+   */
+  bool select(Clock::time_point now) {
+    if (period_ == Clock::duration::zero()) {
+      selected_ = true;
+    } else {
+      selected_ = now >= nextDue_ - period_ / 8;
+      if (selected_) {
+        nextDue_ += period_;
+        if (nextDue_ < now) {
+          nextDue_ = now + period_;
+        }
+      }
+    }
+    return selected_;
+  }
+
+  bool selected() const { return selected_; }
+
+  /**
+   * @brief queues the callback with the frame if it was selected
+   * @param[in] captured when the frame was captured, for the latency stats
+   */
+  void dispatch(ThreadPool &pool, const std::shared_ptr<const Frame> &frame,
+                const std::shared_ptr<EndpointStats> &stats,
+                Clock::time_point captured) {
+    if (!selected_) {
+      return;
+    }
+    Callback callback = callback_;
+    if (!latest_) {
+      pool.enqueue([callback, frame, stats, captured]() {
+        stats->callbackLatency.record(Clock::now() - captured);
+        NDIW_TRACE_SCOPE("frame callback");
+        callback(*frame);
+      });
+      return;
+    }
+    std::lock_guard<std::mutex> lock(latest_->mutex);
+    latest_->frame = frame;
+    latest_->captured = captured;
+    if (latest_->queued) {
+      return; // the queued job takes the newer frame
+    }
+    latest_->queued = true;
+    pool.enqueue([callback, latest = latest_, stats]() {
+      std::shared_ptr<const Frame> newest;
+      Clock::time_point newestCaptured;
+      {
+        std::lock_guard<std::mutex> lock(latest->mutex);
+        newest = std::move(latest->frame);
+        newestCaptured = latest->captured;
+        latest->queued = false;
+      }
+      stats->callbackLatency.record(Clock::now() - newestCaptured);
+      NDIW_TRACE_SCOPE("frame callback");
+      callback(*newest);
+    });
+  }
+
+private:
+  struct Latest {
+    std::mutex mutex;
+    std::shared_ptr<const Frame> frame;
+    Clock::time_point captured;
+    bool queued = false;
+  };
+
+  Callback callback_;
+  Clock::duration period_ = Clock::duration::zero();
+  Clock::time_point nextDue_{};
+  bool selected_ = true;
+  std::shared_ptr<Latest> latest_; // only with latestOnly
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "commontypes.hpp"
+
+/**
+ * @brief downscaling of 4 bytes per pixel images for previews and tiles
+ * @details box averages every source pixel under the output pixel and is the
+ * one to use for big reductions, bilinear takes the four nearest and is
+ * cheaper when the sizes are close. Both use SSE2 where it is available
+ */
+namespace ImageScaling {
+enum class Filter { Box, Bilinear };
+
+/**
+ * @brief scales images to one output size
+ * @details the tables are made for the source size of the first image and
+ * again only when it changes, so scaling the frames of a stream does not
+ * allocate. Not thread safe, use one per thread
+ */
+class Scaler {
+public:
+  Scaler(int width, int height, Filter filter = Filter::Box);
+
+  /**
+   * @brief scales src to dst
+   * @param[in] srcStride bytes from a row to the next of src
+   * @param[in] dst width * height pixels with dstStride bytes between rows
+   */
+  void scale(const uint8_t *src, int srcWidth, int srcHeight, int srcStride,
+             uint8_t *dst, int dstStride);
+
+  /**
+   * @brief scales src to image, the image is resized and its rows are packed
+   */
+  void scale(const uint8_t *src, int srcWidth, int srcHeight, int srcStride,
+             common_types::Image &image);
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  Filter filter() const { return filter_; }
+
+private:
+  /**
+   * @brief makes the tables for the source size if it changed
+   */
+  void prepare(int srcWidth, int srcHeight);
+
+  void scaleBox(const uint8_t *src, int srcStride, uint8_t *dst,
+                int dstStride);
+  void scaleBilinear(const uint8_t *src, int srcStride, uint8_t *dst,
+                     int dstStride);
+
+  int width_;
+  int height_;
+  Filter filter_;
+  int srcWidth_ = 0;
+  int srcHeight_ = 0;
+
+  // box: the source columns [xStart_, xEnd_) and rows [yStart_, yEnd_) of
+  // each output pixel, and 1 / columns of each output column
+  std::vector<int> xStart_, xEnd_, yStart_, yEnd_;
+  std::vector<float> xScale_;
+  std::vector<uint32_t> rowSums_; // 4 channels per output column
+
+  // bilinear: the two source columns and rows and the weight of the second
+  // one in 1 / 256
+  std::vector<int> x0_, x1_, y0_, y1_;
+  std::vector<uint16_t> xWeight_, yWeight_;
+};
+} // namespace ImageScaling
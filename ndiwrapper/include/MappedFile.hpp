@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief a file mapped to memory, mmap on posix and a file mapping on windows
+ * @details the mapping is unmapped and the file closed in the destructor
+ */
+class MappedFile {
+public:
+  enum class Mode {
+    Create,   // creates or truncates the file to the given size, read write
+    ReadWrite, // maps an existing file, read write
+    ReadOnly  // maps an existing file, read only
+  };
+
+  /**
+   * @param[in] size the size of the file with Create, ignored otherwise
+   * @throws std::runtime_error if the file can not be opened or mapped
+   */
+  MappedFile(const std::string &path, Mode mode, size_t size = 0);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  uint8_t *data() { return data_; }
+  const uint8_t *data() const { return data_; }
+  size_t size() const { return size_; }
+
+  /**
+   * @brief asks the os to write the dirty pages to the file, does not wait
+   */
+  void flush();
+
+private:
+  uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  void *file_ = nullptr;
+  void *mapping_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+};
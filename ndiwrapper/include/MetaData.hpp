@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <optional>
 #include <functional>
 #include "tinyxml2.h"
@@ -44,6 +45,12 @@ struct MetadataContainer {
 
 using MetaDataCallback = std::function<void(MetadataContainer)>;
 
+/**
+ * @brief gets the metadata string exactly as it came from the ndi stream without parsing it
+ * @details data is only valid during the call, timecode is the ndi timecode in 100 ns units
+ */
+using RawMetadataCallback = std::function<void(std::string_view data, int64_t timecode)>;
+
 namespace Metadata {
     template<typename T>
     inline void addToXML(tinyxml2::XMLDocument& doc, tinyxml2::XMLElement* root, const T& data);
@@ -99,6 +106,19 @@ namespace Metadata {
         root->InsertEndChild(element);
     }
 
+    /**
+     * @brief adds every field that is set in the container
+     */
+    template<>
+    inline void addToXML<MetadataContainer>(tinyxml2::XMLDocument& doc, tinyxml2::XMLElement* root, const MetadataContainer& container) {
+        if (container.boundingBox) addToXML(doc, root, *container.boundingBox);
+        if (container.zoom) addToXML(doc, root, *container.zoom);
+        if (container.switchCamera) addToXML(doc, root, *container.switchCamera);
+        if (container.aspectRatio) addToXML(doc, root, *container.aspectRatio);
+        if (container.accelerometerData) addToXML(doc, root, *container.accelerometerData);
+        if (container.gyroscopeData) addToXML(doc, root, *container.gyroscopeData);
+    }
+
     template<typename... Args>
     inline std::string encode(const Args&... args) {
         tinyxml2::XMLDocument doc;
@@ -114,21 +134,46 @@ namespace Metadata {
         return printer.CStr();
     }
 
-    inline MetadataContainer decode(const std::string& xmlStr) {
+    /**
+     * @brief cheap check if the xml is made by encode, it does not validate the xml
+     * @details used to skip parsing metadata from other vendors, encode always puts everything under root
+     */
+    inline bool isEncodedMetadata(std::string_view xml) {
+        size_t pos = xml.find("<root");
+        if (pos == std::string_view::npos || pos + 5 >= xml.size()) {
+            return false;
+        }
+        char next = xml[pos + 5];
+        return next == '>' || next == '/' || next == ' ';
+    }
+
+    /**
+     * @brief parses the xml made by encode, unknown elements are ignored
+     * @details the xml comes from the network so nothing is assumed about its structure, missing attributes
+     * default to zero and a bounding box without its start element is dropped
+     * @param[in] xml the xml string, does not need to be null terminated if length is given
+     * @param[in] length length of xml in bytes or size_t(-1) if xml is null terminated
+     */
+    inline MetadataContainer decode(const char* xml, size_t length = static_cast<size_t>(-1)) {
         MetadataContainer container;
+        if (!xml) {
+            return container;
+        }
         tinyxml2::XMLDocument doc;
-        doc.Parse(xmlStr.c_str());
+        if (doc.Parse(xml, length) != tinyxml2::XML_SUCCESS) {
+            return container;
+        }
 
         auto root = doc.FirstChildElement("root");
         if (root) {
             auto bboxElement = root->FirstChildElement("BoundingBox");
-            if (bboxElement) {
+            auto start = bboxElement ? bboxElement->FirstChildElement("start") : nullptr;
+            if (start) {
                 BoundingBox box;
-                auto start = bboxElement->FirstChildElement("start");
-                box.start.x = start->IntAttribute("x");
-                box.start.y = start->IntAttribute("y");
-                box.width = bboxElement->IntAttribute("width");
-                box.height = bboxElement->IntAttribute("height");
+                box.start.x = start->Int64Attribute("x");
+                box.start.y = start->Int64Attribute("y");
+                box.width = bboxElement->Int64Attribute("width");
+                box.height = bboxElement->Int64Attribute("height");
                 container.boundingBox = box;
             }
 
@@ -145,8 +190,8 @@ namespace Metadata {
             auto aspectRatioElement = root->FirstChildElement("AspectRatio");
             if (aspectRatioElement) {
                 AspectRatio ar;
-                ar.width = aspectRatioElement->IntAttribute("width");
-                ar.height = aspectRatioElement->IntAttribute("height");
+                ar.width = aspectRatioElement->Int64Attribute("width");
+                ar.height = aspectRatioElement->Int64Attribute("height");
                 container.aspectRatio = ar;
             }
             auto accElement = root->FirstChildElement("AccelerometerData");
@@ -170,4 +215,8 @@ namespace Metadata {
 
         return container;
     }
+
+    inline MetadataContainer decode(const std::string& xmlStr) {
+        return decode(xmlStr.c_str(), xmlStr.size());
+    }
 }
\ No newline at end of file
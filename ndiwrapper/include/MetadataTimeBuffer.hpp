@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <optional>
+
+#include "AugmentedTypes.hpp"
+#include "MetaData.hpp"
+
+/**
+ * @brief keeps the recent sensor metadata indexed by the ndi timecode
+ * @details metadata sent on the metadata channel arrives separately from the
+ * video frames, this buffer stores the accelerometer and gyroscope samples
+ * with their timecode so they can be matched against the exposure window of a
+ * frame afterwards. Samples older than the history are dropped as new ones
+ * come in. Everything is wrapped in a mutex which makes this thread safe
+ */
+class MetadataTimeBuffer {
+public:
+  /**
+   * @param[in] history how long the samples are kept measured from the newest
+   * sample
+   */
+  explicit MetadataTimeBuffer(
+      std::chrono::milliseconds history = std::chrono::milliseconds(2000));
+
+  /**
+   * @brief stores the sensor data of the container, other fields are ignored
+   * @param[in] timecode the timecode of the metadata frame in 100 ns units
+   */
+  void push(int64_t timecode, const MetadataContainer &container);
+
+  /**
+   * @brief gets the samples inside [startTimecode, endTimecode]
+   * @details if there are no samples inside the window for a sensor then the
+   * nearest sample is returned instead, but only if it is at most the length
+   * of the window away from it
+   */
+  SensorSamples window(int64_t startTimecode, int64_t endTimecode) const;
+
+  /**
+   * @brief linearly interpolates the sensor value at the given timecode
+   * @details outside of the stored range the nearest sample is returned if it
+   * is at most maxDistance away. Between two samples they are interpolated
+   * only if both are at most maxDistance away, otherwise the one that is
+   * close enough is returned, so nothing is returned inside a gap in the
+   * samples that is wider than twice maxDistance
+   * @returns nullopt if there is no sample close enough
+   */
+  std::optional<AccelerometerData> accelerometerAt(
+      int64_t timecode,
+      int64_t maxDistance = std::numeric_limits<int64_t>::max()) const;
+  std::optional<GyroscopeData>
+  gyroscopeAt(int64_t timecode,
+              int64_t maxDistance = std::numeric_limits<int64_t>::max()) const;
+
+  /**
+   * @brief fills the sensors and the missing sensor values of the metadata of
+   * the frame from the samples during the exposure window
+   * @details values the sender put in the metadata of the frame are kept and
+   * samples further than one frame away from the window are not used
+   * @param[in] startTimecode the timecode of the frame
+   * @param[in] duration the length of the exposure window in 100 ns units
+   */
+  template <typename T>
+  void align(DataWithMetadata<T> &frame, int64_t startTimecode,
+             int64_t duration) const;
+
+  bool empty() const;
+  void clear();
+
+private:
+  int64_t history_;
+  mutable std::mutex mutex_;
+  std::deque<TimedSample<AccelerometerData>> accelerometer_;
+  std::deque<TimedSample<GyroscopeData>> gyroscope_;
+};
+
+template <typename T>
+void MetadataTimeBuffer::align(DataWithMetadata<T> &frame,
+                               int64_t startTimecode, int64_t duration) const {
+  int64_t endTimecode = startTimecode + duration;
+  int64_t middle = startTimecode + duration / 2;
+  // up to a frame outside of the window, measured from the middle
+  int64_t maxDistance = duration / 2 + duration;
+  frame.sensors = window(startTimecode, endTimecode);
+  if (!frame.metadata.accelerometerData.has_value()) {
+    frame.metadata.accelerometerData = accelerometerAt(middle, maxDistance);
+  }
+  if (!frame.metadata.gyroscopeData.has_value()) {
+    frame.metadata.gyroscopeData = gyroscopeAt(middle, maxDistance);
+  }
+}
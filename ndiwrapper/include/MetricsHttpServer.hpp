@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+/**
+ * @brief a minimal http server on localhost that answers every request with
+ * the OpenMetrics text of the live endpoints
+ * @details meant for a prometheus scrape or curl, one request at a time and
+ * the connection is closed after the answer. It binds only to 127.0.0.1, put
+ * a proxy or the node exporter in front of it to expose it further
+ */
+class MetricsHttpServer {
+public:
+  /**
+   * @param[in] port the port on 127.0.0.1, 0 lets the system pick one
+   */
+  explicit MetricsHttpServer(uint16_t port = 9464);
+
+  /**
+   * @brief stops the server
+   */
+  ~MetricsHttpServer();
+
+  MetricsHttpServer(const MetricsHttpServer &) = delete;
+  MetricsHttpServer &operator=(const MetricsHttpServer &) = delete;
+
+  /**
+   * @brief binds the port and starts answering on a thread
+   * @returns false if the port could not be bound
+   */
+  bool start();
+
+  void stop();
+
+  /**
+   * @returns the port the server listens on, valid after start
+   */
+  uint16_t port() const { return port_; }
+
+private:
+  void serve();
+
+  uint16_t port_;
+  std::atomic<bool> running_;
+  std::thread thread_;
+#ifdef _WIN32
+  uintptr_t socket_;
+#else
+  int socket_;
+#endif
+};
@@ -1,12 +1,16 @@
 #pragma once
 
-#include "Logger.hpp"
+#include "NDIWLog.hpp"
 #include <NDILibraryManager.hpp>
 #include <Processing.NDI.Lib.h>
 #include <atomic>
+#include <chrono>
+#include <cstring>
 #include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <type_traits>
 #include <vector>
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -15,8 +19,10 @@
 #include <dlfcn.h>
 #endif
 
+#include "EndpointStats.hpp"
 #include "MetaData.hpp"
 #include "ThreadPool.hpp"
+#include "Trace.hpp"
 
 /**
  * @brief base class for the ndi receiver and sender, includes the metadata
@@ -35,9 +41,26 @@
 
 template <typename NDIInstanceType> class NDIBase {
 public:
-  using MetadataFunc = std::function<void(NDIlib_metadata_frame_t &metadata)>;
-  using CaptureMetadataFunc =
-      std::function<NDIlib_frame_type_e(NDIlib_metadata_frame_t &metadata)>;
+  /**
+   * @brief shared ownership of the ndi instance, the deleter destroys the
+   * instance through the ndi lib
+   * @details capture threads take a copy of the handle and block in the SDK
+   * without holding pndiMutex_, so the instance can be swapped while a capture
+   * is in progress and it is destroyed once the last capture returns
+   */
+  using InstanceHandle =
+      std::shared_ptr<std::remove_pointer_t<NDIInstanceType>>;
+  using MetadataFunc = std::function<void(NDIInstanceType instance,
+                                          NDIlib_metadata_frame_t &metadata)>;
+  using CaptureMetadataFunc = std::function<NDIlib_frame_type_e(
+      NDIInstanceType instance, NDIlib_metadata_frame_t &metadata,
+      uint32_t timeoutMs)>;
+
+  /**
+   * @brief how long the metadata thread blocks in the SDK capture call before
+   * checking if it should stop
+   */
+  static constexpr uint32_t kMetadataCaptureTimeoutMs = 100;
 
   /**
    * @brief creates the NDI Lib if its the first object and initializes the
@@ -49,8 +72,12 @@ public:
    * @param[in] send this send the given metadata frame through the ndi stream
    * @param[in] free this frees the given metadataframe from the ndi stream eg.
    * removes it
+   * @param[in] callbackPool the threads the callbacks are called on, endpoints
+   * made by the same factory share one. nullptr creates a pool of 4 threads
+   * for this object
    */
-  NDIBase(CaptureMetadataFunc capture, MetadataFunc send, MetadataFunc free);
+  NDIBase(CaptureMetadataFunc capture, MetadataFunc send, MetadataFunc free,
+          std::shared_ptr<ThreadPool> callbackPool = nullptr);
 
   /**
    * @brief destroys the NDI lib if its the last object
@@ -65,14 +92,29 @@ public:
    */
   template <typename... Args> void sendMetadata(const Args &...args);
 
+  /**
+   * @brief sends the string through the ndi stream as it is
+   * @details for metadata that is not made with the types in MetaData.hpp, eg.
+   * standard ndi ptz or tally xml. The string must be valid xml for the sdk to
+   * pass it through
+   */
+  void sendRawMetadata(const std::string &data);
+
+  /**
+   * @brief same for a nul terminated string, does not allocate
+   */
+  void sendRawMetadata(const char *data, int64_t timecode =
+                                             NDIlib_send_timecode_synthesize);
+
   /**
    * @brief this captures the metadata from ndi stream, checks for errors and
    * calls the callbacks added to this object
-   * @details is a loop that tries to read metadata from the ndi stream and then
-   * sleeps for a time before trying to read again this uses captureMetadata_
-   * and freeMetadata_ functions given in the constructor since they are
-   * receiver/sender specific Also this way one can implement their own timeout
-   * in the captureMetadata_ callback
+   * @details is a loop that blocks in the ndi capture call until metadata
+   * arrives or kMetadataCaptureTimeoutMs passes. The instance handle is copied
+   * under pndiMutex_ but the capture itself runs without the lock so it does
+   * not contend with the frame capture or the output switching. This uses
+   * captureMetadata_ and freeMetadata_ functions given in the constructor since
+   * they are receiver/sender specific
    */
   void metadataThreadLoop();
 
@@ -94,14 +136,45 @@ public:
    */
   void addMetadataCallback(MetaDataCallback callback);
 
+  /**
+   * @brief adds a callback that gets every metadata frame without parsing it
+   * @details the callback is called on the metadata thread before the frame is
+   * given back to the sdk, so copy the data if you need it later and return
+   * quickly. Metadata that is not made by Metadata::encode is never parsed, it
+   * only goes to these callbacks
+   */
+  void addRawMetadataCallback(RawMetadataCallback callback);
+
+  /**
+   * @brief the statistics of this endpoint, can be called any time from any
+   * thread and it does not stop the capture
+   */
+  virtual EndpointStatsSnapshot getStats();
+
 protected:
-  NDIInstanceType pNDIInstance_;
+  /**
+   * @brief copies the current instance handle under pndiMutex_
+   * @returns the handle or nullptr if there is no instance
+   */
+  InstanceHandle currentInstance();
+
+  /**
+   * @brief called on the metadata thread for each decoded metadata frame
+   * before the callbacks are queued
+   * @details the frame is still owned by the sdk, do not keep pointers to it
+   */
+  virtual void onMetadataFrame(const NDIlib_metadata_frame_t & /*frame*/,
+                               const MetadataContainer & /*container*/) {}
+
+  InstanceHandle pNDIInstance_;
   std::mutex pndiMutex_;
 
   CaptureMetadataFunc captureMetadata_;
   MetadataFunc sendMetadata_;
   MetadataFunc freeMetadata_;
-  ThreadPool threadPool_;
+  std::shared_ptr<ThreadPool> threadPool_;
+  // shared with the queued callbacks which record their latency
+  std::shared_ptr<EndpointStats> stats_;
   const NDIlib_v6 *lib;
 
 private:
@@ -109,6 +182,8 @@ private:
   std::thread metadataThread_;
   std::mutex metadataCallbackMutex_;
   std::vector<MetaDataCallback> _metadataCallbacks;
+  std::mutex rawMetadataCallbackMutex_;
+  std::vector<RawMetadataCallback> _rawMetadataCallbacks;
 };
 
 template <typename NDIInstanceType>
@@ -118,28 +193,29 @@ void NDIBase<NDIInstanceType>::sendMetadata(const Args &...args) {
   NDIlib_metadata_frame_t metadata;
   metadata.length =
       static_cast<int>(encodedMetadata.size()) + 1; // +1 for null terminator
-  metadata.p_data = new char[metadata.length];
-  std::strcpy(metadata.p_data, encodedMetadata.c_str());
+  // the sdk copies the metadata before returning, no need for our own copy
+  metadata.p_data = const_cast<char *>(encodedMetadata.c_str());
 
-  {
-    std::lock_guard<std::mutex> lock(pndiMutex_);
-    sendMetadata_(metadata);
+  auto instance = currentInstance();
+  if (instance) {
+    sendMetadata_(instance.get(), metadata);
   }
-
-  delete[] metadata.p_data;
 }
 
 template <typename NDIInstanceType>
 NDIBase<NDIInstanceType>::NDIBase(CaptureMetadataFunc capture,
-                                  MetadataFunc send, MetadataFunc free)
+                                  MetadataFunc send, MetadataFunc free,
+                                  std::shared_ptr<ThreadPool> callbackPool)
     : metadatalistenerrunning_(false), pNDIInstance_(nullptr),
       captureMetadata_(capture), sendMetadata_(send), freeMetadata_(free),
-      threadPool_(4) {
+      threadPool_(callbackPool ? std::move(callbackPool)
+                               : std::make_shared<ThreadPool>(4)),
+      stats_(std::make_shared<EndpointStats>()) {
   auto configDir = getenv("NDI_CONFIG_DIR");
   if (configDir != NULL) {
-    Logger::log_info("NDI_CONFIG_DIR at NDIBASE: ", configDir);
+    NDIW_LOG_DEBUG("NDI_CONFIG_DIR at NDIBASE: ", configDir);
   } else {
-    Logger::log_info("NDI_CONFIG_DIR IS NOT SET IN NDIBASE");
+    NDIW_LOG_DEBUG("NDI_CONFIG_DIR IS NOT SET IN NDIBASE");
   }
 
   lib = NDILibraryManager::Acquire(); // Loads + initializes if first
@@ -148,42 +224,84 @@ template <typename NDIInstanceType> NDIBase<NDIInstanceType>::~NDIBase() {
   NDILibraryManager::Release();
 }
 
+template <typename NDIInstanceType>
+typename NDIBase<NDIInstanceType>::InstanceHandle
+NDIBase<NDIInstanceType>::currentInstance() {
+  std::lock_guard<std::mutex> lock(pndiMutex_);
+  return pNDIInstance_;
+}
+
+template <typename NDIInstanceType>
+EndpointStatsSnapshot NDIBase<NDIInstanceType>::getStats() {
+  EndpointStatsSnapshot snapshot = stats_->snapshot();
+  snapshot.callbackQueueDepth = threadPool_->queueSize();
+  return snapshot;
+}
+
 template <typename NDIInstanceType>
 void NDIBase<NDIInstanceType>::metadataThreadLoop() {
   try {
     while (metadatalistenerrunning_.load()) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      auto instance = currentInstance();
+      if (!instance) {
+        // nothing to listen to yet, the receiver has no output set
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        continue;
+      }
 
       NDIlib_metadata_frame_t metaDataFrame;
+      NDIlib_frame_type_e type;
       {
-        std::lock_guard<std::mutex> lock(pndiMutex_);
-        if (!pNDIInstance_)
-          continue;
-
-        NDIlib_frame_type_e type = captureMetadata_(metaDataFrame);
-
-        if (type != NDIlib_frame_type_e::NDIlib_frame_type_metadata)
-          continue;
+        NDIW_TRACE_SCOPE("metadata capture");
+        type = captureMetadata_(instance.get(), metaDataFrame,
+                                kMetadataCaptureTimeoutMs);
       }
 
+      if (type != NDIlib_frame_type_e::NDIlib_frame_type_metadata)
+        continue;
+      stats_->metadataFrames.fetch_add(1, std::memory_order_relaxed);
+
       try {
         if (metaDataFrame.p_data) {
-          MetadataContainer container = Metadata::decode(metaDataFrame.p_data);
+          std::string_view data(metaDataFrame.p_data);
+          {
+            std::lock_guard<std::mutex> lock(rawMetadataCallbackMutex_);
+            for (const auto &callback : _rawMetadataCallbacks) {
+              callback(data, metaDataFrame.timecode);
+            }
+          }
+        }
+        // only parse what is ours, everything else goes to raw callbacks only
+        if (metaDataFrame.p_data &&
+            Metadata::isEncodedMetadata(metaDataFrame.p_data)) {
+          auto decodeStart = std::chrono::steady_clock::now();
+          MetadataContainer container;
+          {
+            NDIW_TRACE_SCOPE("metadata decode");
+            container = Metadata::decode(metaDataFrame.p_data);
+          }
+          auto decoded = std::chrono::steady_clock::now();
+          stats_->metadataDecodeTime.record(decoded - decodeStart);
+          onMetadataFrame(metaDataFrame, container);
 
           std::lock_guard<std::mutex> lock(metadataCallbackMutex_);
           for (const auto &callback : _metadataCallbacks) {
             MetadataContainer containerCopy = container;
-            threadPool_.enqueue([=]() { callback(containerCopy); });
+            threadPool_->enqueue([=, stats = stats_]() {
+              stats->callbackLatency.record(std::chrono::steady_clock::now() -
+                                            decoded);
+              NDIW_TRACE_SCOPE("metadata callback");
+              callback(containerCopy);
+            });
           }
-
-          freeMetadata_(metaDataFrame);
         }
       } catch (const std::exception &e) {
-        Logger::log_error("could not decode metadata", e.what());
+        NDIW_LOG_ERROR_EVERY(1000, "could not decode metadata", e.what());
       }
+      freeMetadata_(instance.get(), metaDataFrame);
     }
   } catch (const std::exception &e) {
-    Logger::log_error("Could not handle metadata", e.what());
+    NDIW_LOG_ERROR("Could not handle metadata", e.what());
   }
 }
 
@@ -193,7 +311,7 @@ void NDIBase<NDIInstanceType>::stopMetadataListening() {
   if (metadataThread_.joinable()) {
     metadataThread_.join();
   }
-  Logger::log_info("Metadata stopped");
+  NDIW_LOG_DEBUG("Metadata stopped");
 }
 
 template <typename NDIInstanceType>
@@ -202,12 +320,39 @@ void NDIBase<NDIInstanceType>::startMetadataListening() {
 
     metadatalistenerrunning_.store(true);
     metadataThread_ = std::thread(&NDIBase::metadataThreadLoop, this);
-    Logger::log_info("Metadata started");
+    NDIW_LOG_DEBUG("Metadata started");
   } else {
-    Logger::log_warn("metadata listening already running");
+    NDIW_LOG_WARN("metadata listening already running");
   }
 }
 
+template <typename NDIInstanceType>
+void NDIBase<NDIInstanceType>::sendRawMetadata(const std::string &data) {
+  sendRawMetadata(data.c_str());
+}
+
+template <typename NDIInstanceType>
+void NDIBase<NDIInstanceType>::sendRawMetadata(const char *data,
+                                               int64_t timecode) {
+  NDIlib_metadata_frame_t metadata;
+  // the length includes the null terminator
+  metadata.length = static_cast<int>(std::strlen(data)) + 1;
+  metadata.timecode = timecode;
+  metadata.p_data = const_cast<char *>(data);
+
+  auto instance = currentInstance();
+  if (instance) {
+    sendMetadata_(instance.get(), metadata);
+  }
+}
+
+template <typename NDIInstanceType>
+void NDIBase<NDIInstanceType>::addRawMetadataCallback(
+    RawMetadataCallback callback) {
+  std::lock_guard<std::mutex> lock(rawMetadataCallbackMutex_);
+  _rawMetadataCallbacks.push_back(callback);
+}
+
 template <typename NDIInstanceType>
 void NDIBase<NDIInstanceType>::addMetadataCallback(
     MetaDataCallback metadataCallback) {
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "EndpointStats.hpp"
+#include "ImageScaling.hpp"
+#include "NDIReceiver.hpp"
+#include "NDISender.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * @brief where a source goes in the output, in output pixels
+ */
+struct CompositorTile {
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+};
+
+/**
+ * @brief a multiviewer, puts the latest frames of receivers to tiles of one
+ * output and sends it at a fixed rate
+ * @details every source is subscribed with addScaledFrameCallback at the tile
+ * size, latest only and at most at the output rate, so the receivers scale
+ * straight from the sdk buffers and nothing bigger than a tile is copied. The
+ * output frames are two preallocated RGBA buffers that take turns, the tiles
+ * are copied in by the worker threads in bands of rows and the frame is sent
+ * async. A source that has no frame yet is left as the background and a
+ * source that stops keeps its last frame
+ */
+class NDICompositor {
+public:
+  struct Options {
+    int width = 1920;
+    int height = 1080;
+    int frameRateN = 30000;
+    int frameRateD = 1001;
+    // threads for the copying, 0 uses the hardware thread count
+    size_t threads = 0;
+    ImageScaling::Filter filter = ImageScaling::Filter::Box;
+    std::array<uint8_t, 4> background = {0, 0, 0, 255}; // RGBA
+  };
+
+  /**
+   * @param[in] sender where the output goes, created without clocking since
+   * the compositor does the timing
+   * @throws std::runtime_error if there is no sender or the size is not valid
+   */
+  NDICompositor(std::shared_ptr<NDISender> sender, const Options &options);
+
+  /**
+   * @brief stops and waits until the sdk has let go of the output buffers
+   */
+  ~NDICompositor();
+
+  NDICompositor(const NDICompositor &) = delete;
+  NDICompositor &operator=(const NDICompositor &) = delete;
+
+  /**
+   * @brief shows the frames of the receiver in the tile, the tile is clipped to
+   * the output and the sources added later are drawn on top
+   * @returns false if the tile is outside of the output
+   */
+  bool addSource(NDIReceiver &receiver, const CompositorTile &tile);
+
+  /**
+   * @returns columns x rows tiles of the same size covering width x height
+   * with gap pixels between them, row by row
+   */
+  static std::vector<CompositorTile> grid(int columns, int rows, int width,
+                                          int height, int gap = 0);
+
+  /**
+   * @brief starts sending at the frame rate, does nothing if already running
+   */
+  void start();
+
+  void stop();
+
+  uint64_t framesSent() const { return framesSent_; }
+
+  /**
+   * @returns how long putting together one output frame has taken
+   */
+  LatencyHistogram::Snapshot composeTime() const {
+    return composeTime_.snapshot();
+  }
+
+private:
+  struct Source {
+    CompositorTile tile;
+    std::mutex mutex;
+    std::shared_ptr<const Image> latest; // tile sized, set by the callback
+  };
+
+  void run();
+
+  /**
+   * @brief copies the tiles to the rows [rowBegin, rowEnd) of the output
+   */
+  void composeRows(uint8_t *output,
+                   const std::vector<std::shared_ptr<const Image>> &frames,
+                   int rowBegin, int rowEnd) const;
+
+  std::shared_ptr<NDISender> sender_;
+  Options options_;
+  std::unique_ptr<ThreadPool> pool_;
+  size_t threadCount_;
+
+  std::mutex sourcesMutex_;
+  std::vector<std::shared_ptr<Source>> sources_;
+
+  std::array<std::vector<uint8_t>, 2> buffers_;
+  size_t currentBuffer_ = 0;
+
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::atomic<uint64_t> framesSent_{0};
+  LatencyHistogram composeTime_;
+};
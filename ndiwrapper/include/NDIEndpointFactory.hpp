@@ -0,0 +1,90 @@
+#pragma once
+
+#include "NDIReceiver.hpp"
+#include "NDISender.hpp"
+#include "NDISourceDiscovery.hpp"
+#include "ThreadPool.hpp"
+
+#include <Processing.NDI.Lib.h>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief creates senders and receivers in parallel on threads that are
+ * already running
+ * @details the factory keeps the ndi runtime loaded for its lifetime so the
+ * endpoints never pay the library load, and every endpoint it creates shares
+ * one callback pool instead of spawning 4 threads each. The creation happens
+ * on the factory threads and the result comes through the future, if the
+ * constructor throws the future rethrows it on get.
+ *
+ * The factory must outlive the futures it returned, the endpoints themselves
+ * can outlive the factory since they hold the callback pool and the runtime
+ */
+class NDIEndpointFactory {
+public:
+  /**
+   * @brief loads the ndi runtime and starts the threads
+   * @param[in] creationThreads how many endpoints are created at the same
+   * time, 0 uses the hardware thread count
+   * @param[in] callbackThreads size of the callback pool the endpoints share
+   * @throws std::runtime_error if the ndi lib could not be loaded
+   */
+  NDIEndpointFactory(size_t creationThreads = 0, size_t callbackThreads = 4);
+
+  /**
+   * @brief waits for the pending creations and releases the runtime
+   */
+  ~NDIEndpointFactory();
+
+  NDIEndpointFactory(const NDIEndpointFactory &) = delete;
+  NDIEndpointFactory &operator=(const NDIEndpointFactory &) = delete;
+
+  /**
+   * @brief starts the source discovery for the group now so the receivers
+   * created for it see the sources right after start
+   * @details the discovery is kept alive as long as the factory
+   */
+  void warmDiscovery(const std::string &group = "", bool findGroup = true);
+
+  /**
+   * @brief creates a sender, takes the same parameters as NDISender
+   */
+  std::future<std::unique_ptr<NDISender>>
+  createSender(const std::string &name, const std::string &group = "",
+               bool enableVideo = true, bool enableAudio = false);
+
+  /**
+   * @brief creates a receiver, takes the same parameters as NDIReceiver
+   */
+  std::future<std::unique_ptr<NDIReceiver>>
+  createReceiver(const std::string &group = "", bool findGroup = true,
+                 bool synced = false,
+                 NDIlib_recv_bandwidth_e bandwidth =
+                     NDIlib_recv_bandwidth_highest);
+
+  /**
+   * @brief creates a sender for each name, all in the same group
+   * @returns the futures in the order of the names
+   */
+  std::vector<std::future<std::unique_ptr<NDISender>>>
+  createSenders(const std::vector<std::string> &names,
+                const std::string &group = "", bool enableVideo = true,
+                bool enableAudio = false);
+
+  /**
+   * @brief the callback pool given to the created endpoints
+   */
+  std::shared_ptr<ThreadPool> callbackPool() const { return callbackPool_; }
+
+private:
+  const NDIlib_v6 *lib_;
+  std::shared_ptr<ThreadPool> callbackPool_;
+
+  std::mutex discoveryMutex_;
+  std::vector<std::shared_ptr<NDISourceDiscovery>> discoveries_;
+  std::unique_ptr<ThreadPool> creationPool_;
+};
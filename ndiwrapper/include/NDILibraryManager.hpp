@@ -11,121 +11,107 @@
 
 #include "Logger.hpp"
 #include "Processing.NDI.DynamicLoad.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <mutex>
 #include <string>
 #include <vector>
 
+/**
+ * @brief loads the ndi runtime for the first user and keeps count of the users
+ * @details Acquire is lock free once the runtime is loaded, only loading and
+ * unloading take the mutex. What happens when the last user releases depends
+ * on the residency, by default the runtime is destroyed right away like before
+ * but it can be kept loaded for a while or for the whole process so that
+ * creating and destroying endpoints does not pay the full ndi initialization
+ * every time
+ */
 class NDILibraryManager {
 public:
+  enum class Residency {
+    Release, // destroy the runtime when the last user releases it
+    Linger,  // destroy it after the linger time if no one acquires it again
+    Process  // keep it loaded until the process exits
+  };
+
+  /**
+   * @brief how long loading the runtime took, for startup instrumentation
+   */
+  struct Stats {
+    std::chrono::microseconds loadTime{0};       // finding and loading the lib
+    std::chrono::microseconds initializeTime{0}; // NDIlib initialize
+    uint32_t loads = 0;                          // times the runtime was loaded
+    uint32_t unloads = 0;
+  };
+
+  /**
+   * @brief gets the runtime, loads and initializes it if it is not loaded
+   * @returns the function table or nullptr if the runtime could not be loaded,
+   * every successful Acquire must be paired with Release
+   */
   static const NDIlib_v6 *Acquire() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (refCount_++ == 0) {
-#ifdef _WIN32
-      Logger::log_info("Loading NDI library (Windows)...");
-
-      std::vector<std::string> searchPaths;
-
-      // 1. Same folder as our plugin DLL
-      std::string pluginDir = GetPluginDirectory();
-      if (!pluginDir.empty()) {
-        searchPaths.push_back(pluginDir + "\\Processing.NDI.Lib.x64.dll");
-      }
-
-      // 2. NDI Runtime environment variable (if user has NDI Tools installed)
-      char ndiRuntimePath[MAX_PATH] = {0};
-      size_t len = 0;
-      if (getenv_s(&len, ndiRuntimePath, sizeof(ndiRuntimePath),
-                   "NDI_RUNTIME_DIR_V6") == 0 &&
-          len > 0) {
-        searchPaths.push_back(std::string(ndiRuntimePath) +
-                              "\\Processing.NDI.Lib.x64.dll");
-      }
-
-      // 3. Fallback to just the DLL name (relies on system PATH)
-      searchPaths.push_back("Processing.NDI.Lib.x64.dll");
-
-      // Try each path
-      for (const auto &path : searchPaths) {
-        Logger::log_info("Trying to load NDI from:", path);
-        hNDI_ = LoadLibraryA(path.c_str());
-        if (hNDI_ != NULL) {
-          Logger::log_info("Successfully loaded NDI from:", path);
-          break;
-        } else {
-          DWORD error = GetLastError();
-          Logger::log_info("Failed to load from", path, "- error:", error);
-        }
-      }
-
-      if (hNDI_ == NULL) {
-        DWORD error = GetLastError();
-        Logger::log_error("Could not load Processing.NDI.Lib.x64.dll from any "
-                          "location, last error:",
-                          error);
-        refCount_--;
-        return nullptr;
-      }
-
-      auto load_fn =
-          (const NDIlib_v6 *(*)(void))GetProcAddress(hNDI_, "NDIlib_v6_load");
-#else
-      Logger::log_info("Loading NDI library (Linux)...");
-      hNDI_ = dlopen("libndi.so", RTLD_NOW);
-      if (hNDI_ == nullptr) {
-        Logger::log_error("Could not load libndi.so:", dlerror());
-        refCount_--;
-        return nullptr;
-      }
-      auto load_fn = (const NDIlib_v6 *(*)(void))dlsym(hNDI_, "NDIlib_v6_load");
-#endif
-
-      if (!load_fn) {
-        Logger::log_error("NDIlib_v6_load function not found");
-#ifdef _WIN32
-        FreeLibrary(hNDI_);
-#else
-        dlclose(hNDI_);
-#endif
-        hNDI_ = nullptr;
-        refCount_--;
-        return nullptr;
-      }
-
-      lib_ = load_fn();
-      if (lib_) {
-        lib_->initialize();
-        Logger::log_info("NDI initialized successfully");
-      } else {
-        Logger::log_error("NDIlib_v6_load returned nullptr");
-        refCount_--;
-        return nullptr;
-      }
+    refCount_++;
+    // steady path, the runtime is loaded and nothing needs the lock
+    const NDIlib_v6 *lib = lib_.load();
+    if (lib) {
+      return lib;
     }
-    return lib_;
+    return AcquireSlow();
   }
 
+  /**
+   * @brief gives up the runtime, what happens on the last release depends on
+   * the residency
+   */
   static void Release() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (--refCount_ == 0 && lib_) {
-      Logger::log_info("Releasing NDI library...");
-      lib_->destroy();
-      lib_ = nullptr;
-#ifdef _WIN32
-      if (hNDI_) {
-        FreeLibrary(hNDI_);
-        hNDI_ = nullptr;
-      }
-#else
-      if (hNDI_) {
-        dlclose(hNDI_);
-        hNDI_ = nullptr;
-      }
-#endif
-      Logger::log_info("NDI library released");
+    if (--refCount_ == 0) {
+      OnLastRelease();
     }
   }
 
+  /**
+   * @brief sets what happens when the last user releases the runtime
+   * @param[in] linger how long the runtime is kept with Residency::Linger
+   */
+  static void SetResidency(
+      Residency residency,
+      std::chrono::milliseconds linger = std::chrono::milliseconds(5000));
+
+  /**
+   * @returns the timings of the last load and the load counts
+   */
+  static Stats GetStats();
+
 private:
+  /**
+   * @brief loads the runtime under the mutex if no one else did
+   */
+  static const NDIlib_v6 *AcquireSlow();
+
+  /**
+   * @brief unloads now or schedules the unload depending on the residency
+   */
+  static void OnLastRelease();
+
+  /**
+   * @brief unloads the runtime if there are no users, mutex_ must be held
+   */
+  static void UnloadIfUnused();
+
+  /**
+   * @brief finds, loads and initializes the runtime, mutex_ must be held
+   * @details a library given in NDIWRAPPER_NDI_LIBRARY is tried first, eg. a
+   * stand-in runtime for load testing, then the runtime from
+   * NDI_RUNTIME_DIR_V6 and the default locations
+   */
+  static const NDIlib_v6 *Load();
+
+  /**
+   * @brief waits for the linger time to pass and unloads if still unused
+   */
+  static void LingerLoop();
+
 #ifdef _WIN32
   static std::string GetPluginDirectory() {
     char path[MAX_PATH] = {0};
@@ -147,8 +133,11 @@ private:
 #endif
 
   static std::mutex mutex_;
-  static int refCount_;
-  static const NDIlib_v6 *lib_;
+  static std::atomic<int> refCount_;
+  static std::atomic<const NDIlib_v6 *> lib_;
+  static std::atomic<Residency> residency_;
+  static std::atomic<int64_t> lingerMs_;
+  static Stats stats_; // guarded by mutex_
 #ifdef _WIN32
   static HMODULE hNDI_;
 #else
@@ -6,6 +6,8 @@
 #include <atomic>
 #include <Processing.NDI.Lib.h>
 #include <map>
+#include <set>
+#include <chrono>
 #include <functional>
 #include <optional>
 
@@ -13,21 +15,42 @@
 #include "ThreadPool.hpp"
 #include "MetaData.hpp"
 #include "AugmentedTypes.hpp"
+#include "MetadataTimeBuffer.hpp"
 #include "Logger.hpp"
 
+#include "AudioConversion.hpp"
+#include "FrameRecorder.hpp"
+#include "FrameSubscription.hpp"
+#include "ImageScaling.hpp"
 #include "NDIBase.hpp"
+#include "NDISourceDiscovery.hpp"
 
 using namespace common_types;
 
 using FrameCallback = std::function<void(Image)>;
 using NDISourceCallback = std::function<void(std::string)>;
+using NDISourceEventCallback = std::function<void(NDISourceEvent)>;
 using AudioCallback = std::function<void(Audio)>;
+using Audio16Callback = std::function<void(Audio16)>;
+using Audio24Callback = std::function<void(Audio24)>;
 using FrameWithMetadataCallback = std::function<void(DataWithMetadata<Image>)>;
 
 using ConnectionCallback = std::function<void()>;
 using ConnectionCallbackAudio = std::function<void(Audio)>;
 using ConnectionCallbackVideo = std::function<void(Image)>;
 
+/**
+ * @brief the output clock of the synced mode
+ * @details frames and audio are taken from the framesync at frameRateN / frameRateD frames per second, the audio
+ * of each frame is resampled to sampleRate and channels by the sdk
+ */
+struct FrameSyncSettings {
+	int frameRateN = 30000;
+	int frameRateD = 1001;
+	int sampleRate = 48000;
+	int channels = 2;
+};
+
 using NDIFrame = std::pair<std::optional<DataWithMetadata<Audio>>, std::optional<DataWithMetadata<Image>>>;
 /**
  * @brief the receiver implementation, for sources and frames there is callbacks when new one comes
@@ -49,8 +72,14 @@ public:
 	 * @param[in] groupToFind is the group that this receiver listens to
 	 * @param[in] findGroup controls if we are actually finding the group. If this is set to false, then sources that have no group
 	 * are added
+	 * @param[in] bandwidth what the sender sends us, lowest gives a preview quality stream which is enough for monitoring.
+	 * With audio only no video is requested from the sdk at all, and with metadata only the frame thread does not
+	 * capture anything and only the metadata thread receives
+	 * @param[in] callbackPool threads for the callbacks, nullptr gives the receiver its own
 	 */
-	NDIReceiver(const std::string& groupToFind = "", bool findGroup = true, bool synced = false);
+	NDIReceiver(const std::string& groupToFind = "", bool findGroup = true, bool synced = false,
+		NDIlib_recv_bandwidth_e bandwidth = NDIlib_recv_bandwidth_highest,
+		std::shared_ptr<ThreadPool> callbackPool = nullptr);
 
 	/**
 	 * @brief stops the source listening, and frame listening
@@ -87,24 +116,68 @@ public:
 
 	/**
 	 * @brief connects to the given output
-	 * @param[in] outputName the mdns name of the source, this must be in the ndiSources_ map
+	 * @param[in] outputName the mdns name of the source, this must be in the current sources
 	 * @returns true if it set new output and false if it did not do anything due to error or the source is already set
 	 */
 	bool setOutput(const std::string& outputName);
 
+	/**
+	 * @brief keeps receivers connected to the given sources so that setOutput to one of them is only a swap
+	 * @details the standby receivers are connected as soon as the sources are found and stay connected until
+	 * they are removed from the list. When switching away from an output that is in the list it stays connected.
+	 * Standbys cost network and decoding, a lower bandwidth for them saves that. After a switch to a standby of
+	 * another bandwidth the output shows the standby while a receiver with the bandwidth of this receiver connects
+	 * in the background, and that replaces the standby once it delivers
+	 * @param[in] sources the names of the sources to keep warm, replaces the previous list
+	 * @param[in] bandwidth the bandwidth the standby receivers are created with
+	 */
+	void setStandbySources(const std::vector<std::string>& sources,
+		NDIlib_recv_bandwidth_e bandwidth = NDIlib_recv_bandwidth_highest);
+
+	/**
+	 * @brief sets the output clock used when the receiver is synced
+	 * @note not synchronized, takes effect when the frame generation is started
+	 */
+	void setFrameSyncSettings(const FrameSyncSettings& settings);
+
+	/**
+	 * @brief changes the bandwidth of the receiver
+	 * @details if connected the receiver is connected again with the new bandwidth and swapped in, the frames keep
+	 * coming from the old connection until then
+	 */
+	void setBandwidth(NDIlib_recv_bandwidth_e bandwidth);
+
+	/**
+	 * @returns the bandwidth new connections are made with
+	 */
+	NDIlib_recv_bandwidth_e getBandwidth();
+
+	/**
+	 * @returns how long the last successful setOutput took
+	 */
+	std::chrono::microseconds getLastSwitchLatency() const;
+
+	/**
+	 * @brief the counters of the receiver with the dropped frames and the queue depths the sdk reports for the
+	 * current connection
+	 */
+	EndpointStatsSnapshot getStats() override;
+
 	/**
 	 * @brief gets the current sources
+	 * @details reads the snapshot of the shared discovery, does not lock
 	 * @returns the sources names gathered this far 
 	 */
 	std::vector<std::string> getCurrentSources();
 
 	/**
-	 * @brief stops the source listening thread
+	 * @brief stops listening to the source changes
 	 */
 	void stopSourceFinding();
 
 	/**
-	 * @brief starts the source listening thread
+	 * @brief starts listening to the source changes
+	 * @details the sources are found by a NDISourceDiscovery that is shared with every receiver looking for the same group
 	 */
 	void startSourceFinding();
 
@@ -122,9 +195,29 @@ public:
 	 * @brief adds a callback which gets called each time a new frame comes in
 	 * @param[in] frameCallback the frame callback which gets called
 	 * The frames are hard coded to be RGBA images
+	 * @param[in] subscription the rate and the queueing of the frames, a frame that no callback takes is not
+	 * copied out of the sdk buffer unless getFrame needs it, see setFullFrameCopy
 	 */
-	void addFrameCallback(FrameCallback frameCallback);
-	void addFrameWithMetadataCallback(FrameWithMetadataCallback frameCallback);
+	void addFrameCallback(FrameCallback frameCallback, const FrameSubscription& subscription = {});
+	void addFrameWithMetadataCallback(FrameWithMetadataCallback frameCallback,
+		const FrameSubscription& subscription = {});
+
+	/**
+	 * @brief adds a callback which gets the frames scaled to width x height, eg. for previews and multiviewer tiles
+	 * @details the frame is scaled straight from the sdk buffer once per size and filter, the callbacks with the
+	 * same size and filter share the result. Use with setFullFrameCopy(false) to not copy the full frame at all
+	 * when nothing else needs it
+	 */
+	void addScaledFrameCallback(int width, int height, FrameCallback frameCallback,
+		ImageScaling::Filter filter = ImageScaling::Filter::Box, const FrameSubscription& subscription = {});
+
+	/**
+	 * @brief with false the full size frame is copied only if a frame callback takes it
+	 * @details getFrame and the video connected callback get images without pixels then, the size and the
+	 * timestamp are still set. On by default
+	 */
+	void setFullFrameCopy(bool enabled);
+
 	/**
 	 * @brief adds a callback which gets called each time a audio comes in
 	 * @param[in] audioCallback the audio callback which gets called
@@ -132,11 +225,35 @@ public:
 	void addAudioCallback(AudioCallback audioCallback);
 
 	/**
-	 * @brief adds a frame callback
-	 * @param[in] frameCallback the frame callback which gets called each time new frame comes in
+	 * @brief adds a callback which gets the audio as interleaved 16 bit
+	 * @details the conversion is done once per audio frame and only if there is a callback for it
+	 */
+	void addAudio16Callback(Audio16Callback audioCallback);
+
+	/**
+	 * @brief adds a callback which gets the audio as interleaved 24 bit
+	 */
+	void addAudio24Callback(Audio24Callback audioCallback);
+
+	/**
+	 * @brief sets the layout and the channels of the float audio, getAudio and the audio callbacks get it in this
+	 * format and the 16 and 24 bit audio is made from it
+	 * @details by default the audio is planar with the channels of the source
+	 */
+	void setAudioFormat(const AudioFormat& format);
+
+	/**
+	 * @brief adds a source callback
+	 * @param[in] sourceCallback gets called with the name once for each new source
 	 */
 	void addNDISourceCallback(NDISourceCallback sourceCallback);
 
+	/**
+	 * @brief adds a source event callback
+	 * @param[in] sourceEventCallback gets called only when a source is added, removed or changes its address
+	 */
+	void addNDISourceEventCallback(NDISourceEventCallback sourceEventCallback);
+
 	/**
 	 * @brief switches between finding group defined in constructor
 	 * @param[in] state true to get only the group defined sources false to get sources with no group
@@ -144,7 +261,7 @@ public:
 	void setFindOnlyGroupsState(bool state);
 
 	/**
-	 * @brief empties the ndiSources_ map 
+	 * @brief restarts the receiver and picks the discovery again, used when the group settings change
 	 */
 	void resetSources();
 
@@ -171,25 +288,123 @@ public:
 	 * @note not synchronized, so set these before you start generating frames
 	 */
 	void setVideoDisconnectedCallback(ConnectionCallback callback);
+
+	/**
+	 * @brief gets the sensor samples that came on the metadata channel between the timecodes
+	 * @details frames given to the frame with metadata callbacks already have these filled for their exposure window
+	 * @param[in] startTimecode start of the window in 100 ns units, same as the ndi timecode
+	 * @param[in] endTimecode end of the window in 100 ns units
+	 */
+	SensorSamples getSensorSamples(int64_t startTimecode, int64_t endTimecode);
+
+	/**
+	 * @brief records the video, audio and metadata as they come from the sdk, before they are converted
+	 * @details the frames are copied to the recording on the capture threads. In the synced mode the recording has
+	 * the frames of the output clock, repeated frames included
+	 * @param[in] recorder the recording, nullptr stops recording
+	 */
+	void setRecorder(std::shared_ptr<FrameRecorder> recorder);
+
+protected:
+	/**
+	 * @brief stores the sensor data from the metadata channel to sensorBuffer_
+	 */
+	void onMetadataFrame(const NDIlib_metadata_frame_t& frame, const MetadataContainer& container) override;
+
 private:
 	/**
-	 * @brief endless loop which updates the sources
-	 * @details this calls every callback in \_ndiSourceCallbacks when a source is found and updates the ndiSources\_
+	 * @brief called by the discovery when the sources change, updates the standbys and queues the source callbacks
+	 */
+	void onSourceEvents(const std::vector<NDISourceEvent>& events);
+
+	/**
+	 * @returns the sources of the discovery or an empty map if source finding has not been started
+	 */
+	std::shared_ptr<const NDISourceMap> sourcesSnapshot();
+
+	struct StandbyConnection {
+		std::string url;
+		InstanceHandle instance;
+		NDIlib_recv_bandwidth_e bandwidth = NDIlib_recv_bandwidth_highest;
+	};
+
+	/**
+	 * @brief makes the instance the current one, creates the framesync for it if synced
+	 * @returns the previous instance
+	 */
+	InstanceHandle installInstance(InstanceHandle instance);
+
+	/**
+	 * @brief creates a receiver connected to the source
+	 * @returns the handle, which holds nullptr if the sdk could not create the receiver
 	 */
-	void updateSources();
+	InstanceHandle createRecvInstance(const std::string& name, const std::string& url, NDIlib_recv_bandwidth_e bandwidth);
+
+	/**
+	 * @brief removes the standby connection of the source from standby_
+	 * @returns the connection or an empty one if the source has no standby
+	 */
+	StandbyConnection takeStandby(const std::string& name);
+
+	/**
+	 * @brief keeps the receiver as a standby if the source is in standbySources_ and the bandwidth is the standby
+	 * bandwidth, otherwise it is released
+	 */
+	void returnToStandby(const std::string& name, const std::string& url, NDIlib_recv_bandwidth_e bandwidth,
+		InstanceHandle instance);
+
+	/**
+	 * @brief swaps in bandwidthRestore_ once it delivers or has tried for long enough, called on the frame thread
+	 */
+	void finishBandwidthRestore();
+
+	/**
+	 * @brief connects the standby sources that are found but are not connected yet
+	 */
+	void connectStandbySources();
+
+	/**
+	 * @brief reconnects the standbys whose address changed and connects the new ones
+	 */
+	void refreshStandby(const std::vector<NDISourceEvent>& events);
 
 	/**
 	 * @brief endless loop waits for the video frames and audio to come from the selected source as they come
 	 * @details calls every callback in \_frameCallbacks with the image and updates the currentFrame\_ with newest image
-	 * The image is RGBA image and its currently hard coded
+	 * The image is RGBA image and its currently hard coded. In the metadata only bandwidth this only keeps the
+	 * output connected
 	 */
 	void generateFrames();
 
 
-	NDIFrame getFrameNDI();
-	NDIFrame getFramesNDISynced();
+	/**
+	 * @brief scales the frame to the sizes of the scaled callbacks and queues the callbacks, called on the frame
+	 * thread before the sdk frame is freed
+	 */
+	void dispatchScaledFrames(const NDIlib_video_frame_v2_t& frame);
+
+	/**
+	 * @brief picks the full size frame callbacks that get the frame captured at now
+	 * @returns true if the full size frame has to be copied out of the sdk buffer
+	 */
+	bool selectFullFrameSubscribers(std::chrono::steady_clock::time_point now);
+
+	/**
+	 * @brief takes the next audio or video frame from the receiver, the audio is converted to audioFormat
+	 */
+	NDIFrame getFrameNDI(const AudioFormat& audioFormat);
+	/**
+	 * @brief takes the video and the audio of one output frame from the framesync
+	 * @param[in] frameIndex the number of the output frame since the clock started, the audio sample count is
+	 * derived from it
+	 * @param[in] audioFormat what the audio is converted to
+	 */
+	NDIFrame getFramesNDISynced(const FrameSyncSettings& settings, int64_t frameIndex,
+		const AudioFormat& audioFormat);
 
-	std::map<std::string, NDIlib_source_t> ndiSources_;
+	// read and written only with std::atomic_load and std::atomic_store
+	std::shared_ptr<NDISourceDiscovery> discovery_;
+	size_t sourceListenerId_ = 0;
 
 	std::mutex frameMutex_;
 	std::mutex sourceMutex_;
@@ -202,18 +417,35 @@ private:
 	std::condition_variable audioCondition_;
 	bool audioAvailable_ = false;
 
-	std::thread sourceThread_;
 	std::thread frameThread_;
 
 	Image currentFrame_;
 	Audio currentAudio_;
-	NDIlib_source_t currentOutput_;
+	struct {
+		std::string name;
+		std::string url;
+	} currentOutput_; // the source we are connected to
 	std::string currentOutputString_;
 
-	std::vector<FrameCallback> _frameCallbacks;
+	// the subscribers are selected and dispatched only on the frame thread
+	std::vector<FrameSubscriber<Image>> _frameCallbacks;
 	std::vector<NDISourceCallback> _ndiSourceCallbacks;
+	std::vector<NDISourceEventCallback> _ndiSourceEventCallbacks;
 	std::vector<AudioCallback> _audioCallbacks;
-	std::vector<FrameWithMetadataCallback> _frameWithMetadataCallbacks;
+	std::vector<Audio16Callback> _audio16Callbacks;
+	std::vector<Audio24Callback> _audio24Callbacks;
+	// read and written only with std::atomic_load and std::atomic_store
+	std::shared_ptr<const AudioFormat> audioFormat_;
+	std::vector<FrameSubscriber<DataWithMetadata<Image>>> _frameWithMetadataCallbacks;
+	struct ScaledOutput {
+		ImageScaling::Scaler scaler; // only used on the frame thread
+		std::vector<FrameSubscriber<Image>> callbacks;
+	};
+	std::vector<ScaledOutput> scaledOutputs_; // guarded by scaledCallbackMutex_
+	std::mutex scaledCallbackMutex_;
+	std::atomic<bool> fullFrameCopy_{true};
+	// read and written only with std::atomic_load and std::atomic_store
+	std::shared_ptr<FrameRecorder> recorder_;
 
 	ConnectionCallbackAudio _audioConnected;
 	ConnectionCallback _audioDisconnected;
@@ -229,10 +461,30 @@ private:
 	std::atomic<bool> _findGroup;
 	std::string groupToFind_;
 
-	NDIlib_framesync_instance_t _pndiFrameSync;
+	using FrameSyncHandle = std::shared_ptr<std::remove_pointer_t<NDIlib_framesync_instance_t>>;
+	FrameSyncHandle _pndiFrameSync; // guarded by pndiMutex_ like pNDIInstance_
 	bool m_synced;
+	FrameSyncSettings frameSyncSettings_;
+
+	MetadataTimeBuffer sensorBuffer_;
 
 	std::atomic<bool> dontTryToSetSource_;
-	std::mutex setOutputMutex_;
+	std::mutex setOutputMutex_; // locked before standbyMutex_ when both are needed
+	// written under setOutputMutex_, the frame thread reads them to skip what the bandwidth does not carry
+	std::atomic<NDIlib_recv_bandwidth_e> bandwidth_;
+	std::atomic<NDIlib_recv_bandwidth_e> currentBandwidth_; // of the connected receiver
+	// after a warm switch to a standby of another bandwidth, the receiver at bandwidth_ that replaces it once it
+	// delivers. Guarded by setOutputMutex_, the pending flag lets the frame thread skip the lock
+	StandbyConnection bandwidthRestore_;
+	std::chrono::steady_clock::time_point bandwidthRestoreStart_;
+	std::atomic<bool> bandwidthRestorePending_{false};
+
+	std::mutex standbyMutex_;
+	std::set<std::string> standbySources_;
+	NDIlib_recv_bandwidth_e standbyBandwidth_;
+	std::map<std::string, StandbyConnection> standby_;
+
+	std::atomic<int64_t> lastSwitchLatencyUs_;
+	size_t statsId_ = 0; // in StatsRegistry
 };
 
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <Processing.NDI.Lib.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "MetaData.hpp"
+#include "NDISourceDiscovery.hpp"
+#include "ThreadPool.hpp"
+#include "commontypes.hpp"
+
+using GroupFrameCallback =
+    std::function<void(const std::string &source, common_types::Image)>;
+using GroupAudioCallback =
+    std::function<void(const std::string &source, common_types::Audio)>;
+using GroupMetadataCallback =
+    std::function<void(const std::string &source, MetadataContainer)>;
+
+/**
+ * @brief receives many sources with a fixed number of capture threads
+ * @details a NDIReceiver uses its own capture, metadata and pool threads for a
+ * single source. This connects to any number of sources and divides them
+ * between the capture threads, each thread goes through its sources without
+ * waiting and only sleeps when none of them had anything. A thread with only
+ * one source waits in the sdk instead. Video, audio and metadata come from the
+ * same capture call so there are no extra threads for metadata.
+ *
+ * Sources are found with the NDISourceDiscovery shared with the receivers, a
+ * source that is added before it is found gets connected when it is found.
+ * The callbacks are called from the thread pool with the name of the source
+ */
+class NDIReceiverGroup {
+public:
+  /**
+   * @param[in] groupToFind the group the sources are found from
+   * @param[in] findGroup false to find the sources with no group
+   * @param[in] captureThreads number of capture threads, 0 uses the number of
+   * cores
+   * @param[in] bandwidth the bandwidth every source is received with
+   * @param[in] callbackPool threads for the callbacks, nullptr gives the group
+   * its own
+   */
+  NDIReceiverGroup(
+      const std::string &groupToFind = "", bool findGroup = true,
+      size_t captureThreads = 0,
+      NDIlib_recv_bandwidth_e bandwidth = NDIlib_recv_bandwidth_highest,
+      std::shared_ptr<ThreadPool> callbackPool = nullptr);
+
+  /**
+   * @brief stops and disconnects every source
+   */
+  ~NDIReceiverGroup();
+
+  /**
+   * @brief starts the capture threads and the source finding
+   */
+  void start();
+
+  /**
+   * @brief stops the capture threads and the source finding, the sources are
+   * kept and connected again on start
+   */
+  void stop();
+
+  /**
+   * @brief starts receiving the source
+   * @returns false if the source was already added
+   */
+  bool addSource(const std::string &name);
+
+  /**
+   * @brief stops receiving the source
+   */
+  void removeSource(const std::string &name);
+
+  /**
+   * @returns the names of the added sources
+   */
+  std::vector<std::string> getSources();
+
+  /**
+   * @returns the names of the sources found in the network
+   */
+  std::vector<std::string> getAvailableSources();
+
+  /**
+   * @brief the callbacks are called for every source, set them before start
+   */
+  void addFrameCallback(GroupFrameCallback callback);
+  void addAudioCallback(GroupAudioCallback callback);
+  void addMetadataCallback(GroupMetadataCallback callback);
+
+private:
+  using InstanceHandle =
+      std::shared_ptr<std::remove_pointer_t<NDIlib_recv_instance_t>>;
+
+  struct Connection {
+    std::string name;
+    std::string url;
+    InstanceHandle instance; // nullptr until the source is found
+  };
+
+  /**
+   * @brief goes through the connections of the worker until stopped
+   */
+  void captureLoop(size_t worker);
+
+  /**
+   * @brief captures everything that is waiting in the connection
+   * @returns true if something was captured
+   */
+  bool capture(const Connection &connection, uint32_t timeoutMs);
+
+  /**
+   * @brief connects the added sources that were found or changed address
+   */
+  void onSourceEvents(const std::vector<NDISourceEvent> &events);
+
+  /**
+   * @brief creates the receiver for the connection if the source is known,
+   * connectionMutex_ must be held
+   */
+  void connect(Connection &connection, const NDISourceMap &sources);
+
+  /**
+   * @returns the discovery or nullptr if the group has not been started
+   */
+  std::shared_ptr<NDISourceDiscovery> discovery();
+
+  /**
+   * @returns the worker with the fewest connections
+   */
+  size_t leastLoadedWorker() const;
+
+  const NDIlib_v6 *lib;
+  std::string groupToFind_;
+  bool findGroup_;
+  NDIlib_recv_bandwidth_e bandwidth_;
+
+  std::mutex discoveryMutex_; // never held while calling the discovery
+  std::shared_ptr<NDISourceDiscovery> discovery_;
+  size_t sourceListenerId_ = 0;
+
+  std::mutex connectionMutex_;
+  // the connections of each capture thread, the threads copy their own list
+  std::vector<std::vector<std::shared_ptr<Connection>>> workerConnections_;
+  // bumped under connectionMutex_ whenever a connection changes
+  std::atomic<uint64_t> connectionsVersion_;
+
+  std::atomic<bool> running_;
+  std::vector<std::thread> captureThreads_;
+
+  std::mutex callbackMutex_;
+  std::vector<GroupFrameCallback> frameCallbacks_;
+  std::vector<GroupAudioCallback> audioCallbacks_;
+  std::vector<GroupMetadataCallback> metadataCallbacks_;
+
+  std::shared_ptr<ThreadPool> threadPool_;
+};
@@ -5,7 +5,9 @@
 #include <Processing.NDI.Lib.h>
 #include <atomic>
 #include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include "Logger.hpp"
 #include "NDIBase.hpp"
@@ -28,9 +30,12 @@ public:
    * @brief initializes the sender with the given name and group
    * @param[in] name the mdns name of the sender
    * @param[in] group the group of the sender
+   * @param[in] callbackPool threads for the metadata callbacks, nullptr gives
+   * the sender its own
    */
   NDISender(const std::string &name, const std::string &group = "",
-            bool enableVideo = true, bool enableAudio = false);
+            bool enableVideo = true, bool enableAudio = false,
+            std::shared_ptr<ThreadPool> callbackPool = nullptr);
 
   /**
    * @brief stops the metadata listening and sending
@@ -50,16 +55,55 @@ public:
   void feedAudio(Audio16 &audio);
   void asyncFeedFrame(Image &image, NDIlib_FourCC_video_type_e videoType);
 
-  // you must handle yourself the metadata correctly
+  /**
+   * @brief feeds the image with the metadata attached to the video frame
+   * @details the metadata is copied to a buffer that is reused and kept alive
+   * as long as the sdk is sending the frame
+   * @param[in] metadata xml string, you must handle yourself that it is valid
+   */
   void asyncFeedFrame(Image &image, NDIlib_FourCC_video_type_e videoType,
                       std::string metadata);
+
+  /**
+   * @brief feeds the image with the metadata encoded to the video frame
+   * @param[in] metadata the fields that are set are encoded like sendMetadata
+   * encodes them
+   */
+  void asyncFeedFrame(Image &image, NDIlib_FourCC_video_type_e videoType,
+                      const MetadataContainer &metadata);
   void feedAudioAsync(Audio &audio);
   void feedAudioAsync(Audio16 &audio);
+
+  /**
+   * @brief sends a frame that is already in the sdk format, nothing is copied
+   * @details with async the sdk reads the data after this returns, it must
+   * stay untouched until the next async send or flushAsync. Do not mix with
+   * asyncFeedFrame, the buffers of the two are released by each other
+   */
+  void feedVideoFrame(const NDIlib_video_frame_v2_t &frame, bool async = false);
+  void feedAudioFrame(const NDIlib_audio_frame_v2_t &frame);
+
+  /**
+   * @brief waits until the sdk has let go of the last async frame
+   */
+  void flushAsync();
+
   void start();
   void stop();
 
 private:
+  /**
+   * @brief swaps the image to the next frame buffer and sends it async
+   * @param[in] metadata copied to the metadata buffer of the same slot, can
+   * be nullptr
+   */
+  void sendBufferedFrameAsync(Image &image,
+                              NDIlib_FourCC_video_type_e videoType,
+                              const std::string *metadata);
+
   std::vector<Image> m_frameBuffers;
+  std::vector<std::string> m_metadataBuffers; // one per frame buffer
   size_t m_currentBufferIndex = 0;
   std::mutex m_bufferMutex;
+  size_t m_statsId = 0; // in StatsRegistry
 };
\ No newline at end of file
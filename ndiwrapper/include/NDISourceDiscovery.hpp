@@ -0,0 +1,118 @@
+#pragma once
+
+#include <Processing.NDI.Lib.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class NDISourceEventType { Added, Removed, Changed };
+
+/**
+ * @brief tells how the found sources changed, Changed means that the source
+ * with the same name has a new address
+ */
+struct NDISourceEvent {
+  NDISourceEventType type;
+  std::string name;
+  std::string url;
+};
+
+/**
+ * @brief the found sources, name to url address
+ * @details the strings are copied since NDIlib_source_t only points to memory
+ * owned by the finder
+ */
+using NDISourceMap = std::map<std::string, std::string>;
+
+/**
+ * @brief source discovery shared by every receiver in the process that looks
+ * for the same group
+ * @details one finder and one thread per group filter no matter how many
+ * receivers there are. Get the instance with acquire, it lives as long as
+ * someone holds the returned pointer. The current sources are kept in an
+ * immutable snapshot that is swapped atomically when the sources change so
+ * reading them never waits for the discovery thread.
+ *
+ * Listeners are called on the discovery thread only when something changed,
+ * keep them short
+ */
+class NDISourceDiscovery {
+public:
+  using Listener = std::function<void(const std::vector<NDISourceEvent> &)>;
+
+  /**
+   * @brief gets the discovery for the group filter, creates it if no one has
+   * it yet
+   * @param[in] groups the group to find, only used if findGroup is true
+   * @param[in] findGroup false to find the sources with no group
+   * @returns nullptr if the ndi lib could not be loaded
+   */
+  static std::shared_ptr<NDISourceDiscovery> acquire(const std::string &groups,
+                                                     bool findGroup);
+
+  /**
+   * @brief stops the discovery thread and destroys the finder
+   */
+  ~NDISourceDiscovery();
+
+  NDISourceDiscovery(const NDISourceDiscovery &) = delete;
+  NDISourceDiscovery &operator=(const NDISourceDiscovery &) = delete;
+
+  /**
+   * @brief the sources found so far, does not lock
+   */
+  std::shared_ptr<const NDISourceMap> snapshot() const;
+
+  /**
+   * @brief adds a listener for the source changes
+   * @details the listener is first called with an Added event for every
+   * source that is already known, so it does not miss anything
+   * @returns id for unsubscribe
+   */
+  size_t subscribe(Listener listener);
+
+  /**
+   * @brief removes the listener, after this returns the listener is not being
+   * called and won't be called again
+   */
+  void unsubscribe(size_t id);
+
+private:
+  NDISourceDiscovery(const NDIlib_v6 *lib, const std::string &groups,
+                     bool findGroup);
+
+  /**
+   * @brief loop which waits for the finder to tell that the sources changed
+   * and then publishes the new snapshot and calls the listeners
+   */
+  void run();
+
+  /**
+   * @returns the events that turn previous into current
+   */
+  static std::vector<NDISourceEvent> diff(const NDISourceMap &previous,
+                                          const NDISourceMap &current);
+
+  const NDIlib_v6 *lib_;
+  std::string groups_;
+  bool findGroup_;
+  NDIlib_find_instance_t pNDIFind_;
+
+  std::atomic<bool> running_;
+  std::thread thread_;
+
+  // read and written only with std::atomic_load and std::atomic_store
+  std::shared_ptr<const NDISourceMap> sources_;
+
+  std::mutex listenerMutex_;
+  std::map<size_t, Listener> listeners_;
+  size_t nextListenerId_ = 0;
+
+  static std::mutex registryMutex_;
+  static std::map<std::string, std::weak_ptr<NDISourceDiscovery>> registry_;
+};
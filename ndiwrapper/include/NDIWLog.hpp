@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "Logger.hpp"
+
+#ifndef NDIWRAPPER_LOG_LEVEL
+#define NDIWRAPPER_LOG_LEVEL 1
+#endif
+
+/**
+ * @brief level gate in front of the Logger for the wrapper's own messages
+ * @details a message is written only if its level is at least the compiled
+ * level, set with the NDIWRAPPER_LOG_LEVEL cmake option, and the runtime level
+ * set with setLevel. Below the compiled level the macros compile to nothing
+ * and below the runtime level they cost one relaxed load, in both cases the
+ * arguments are not evaluated so nothing is formatted. Hot paths use the rate
+ * limited macros which write at most one message per interval per call site
+ * and tell how many were left out
+ */
+namespace NDIWLog {
+enum class Level { Debug = 0, Info = 1, Warn = 2, Error = 3, Off = 4 };
+
+constexpr Level kCompiledLevel = static_cast<Level>(NDIWRAPPER_LOG_LEVEL);
+
+constexpr bool compiledIn(Level level) { return level >= kCompiledLevel; }
+
+/**
+ * @brief sets the lowest level that is written, Info by default
+ */
+void setLevel(Level level);
+Level level();
+
+inline bool enabled(Level messageLevel) {
+  return compiledIn(messageLevel) && messageLevel >= level();
+}
+
+/**
+ * @brief lets one message through per interval, lock free so it can be used
+ * from any thread
+ */
+class RateLimiter {
+public:
+  explicit RateLimiter(std::chrono::milliseconds interval)
+      : interval_(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      interval)
+                      .count()),
+        next_(0), suppressed_(0) {}
+
+  /**
+   * @param[out] suppressed how many messages were left out since the last one
+   * that was let through
+   * @returns true if this message should be written
+   */
+  bool allow(uint64_t &suppressed) {
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count();
+    int64_t next = next_.load(std::memory_order_relaxed);
+    if (now < next || !next_.compare_exchange_strong(
+                          next, now + interval_, std::memory_order_relaxed)) {
+      suppressed_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+    return true;
+  }
+
+private:
+  const int64_t interval_;
+  std::atomic<int64_t> next_;
+  std::atomic<uint64_t> suppressed_;
+};
+} // namespace NDIWLog
+
+#define NDIW_LOG_AT(level, logFunc, ...)                                       \
+  do {                                                                         \
+    if constexpr (::NDIWLog::compiledIn(level)) {                              \
+      if (::NDIWLog::enabled(level)) {                                         \
+        logFunc(__VA_ARGS__);                                                  \
+      }                                                                        \
+    }                                                                          \
+  } while (0)
+
+#define NDIW_LOG_RATE_LIMITED_AT(level, logFunc, intervalMs, ...)              \
+  do {                                                                         \
+    if constexpr (::NDIWLog::compiledIn(level)) {                              \
+      if (::NDIWLog::enabled(level)) {                                         \
+        static ::NDIWLog::RateLimiter ndiwLogLimiter(                          \
+            std::chrono::milliseconds(intervalMs));                            \
+        uint64_t ndiwLogSuppressed = 0;                                        \
+        if (ndiwLogLimiter.allow(ndiwLogSuppressed)) {                         \
+          if (ndiwLogSuppressed > 0) {                                         \
+            logFunc(__VA_ARGS__, "(suppressed", ndiwLogSuppressed,             \
+                    "times before this)");                                     \
+          } else {                                                             \
+            logFunc(__VA_ARGS__);                                              \
+          }                                                                    \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+  } while (0)
+
+// the Logger has no debug level, debug messages go out as info when enabled
+#define NDIW_LOG_DEBUG(...)                                                    \
+  NDIW_LOG_AT(::NDIWLog::Level::Debug, Logger::log_info, __VA_ARGS__)
+#define NDIW_LOG_INFO(...)                                                     \
+  NDIW_LOG_AT(::NDIWLog::Level::Info, Logger::log_info, __VA_ARGS__)
+#define NDIW_LOG_WARN(...)                                                     \
+  NDIW_LOG_AT(::NDIWLog::Level::Warn, Logger::log_warn, __VA_ARGS__)
+#define NDIW_LOG_ERROR(...)                                                    \
+  NDIW_LOG_AT(::NDIWLog::Level::Error, Logger::log_error, __VA_ARGS__)
+
+#define NDIW_LOG_WARN_EVERY(intervalMs, ...)                                   \
+  NDIW_LOG_RATE_LIMITED_AT(::NDIWLog::Level::Warn, Logger::log_warn,           \
+                           intervalMs, __VA_ARGS__)
+#define NDIW_LOG_ERROR_EVERY(intervalMs, ...)                                  \
+  NDIW_LOG_RATE_LIMITED_AT(::NDIWLog::Level::Error, Logger::log_error,         \
+                           intervalMs, __VA_ARGS__)
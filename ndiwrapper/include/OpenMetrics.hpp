@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "StatsRegistry.hpp"
+
+/**
+ * @brief renders the endpoint statistics in the OpenMetrics text format that
+ * prometheus scrapes
+ * @details every metric is labeled with endpoint (sender or receiver), id
+ * (unique within the process) and name. The latency histograms are in
+ * seconds with the power of two buckets of LatencyHistogram
+ */
+namespace OpenMetrics {
+/**
+ * @brief the content type to serve the text with
+ */
+constexpr const char *kContentType =
+    "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
+/**
+ * @returns the text of the entries ending with # EOF
+ */
+std::string render(const std::vector<StatsRegistry::Entry> &entries);
+
+/**
+ * @returns the text of every live endpoint
+ */
+std::string render();
+} // namespace OpenMetrics
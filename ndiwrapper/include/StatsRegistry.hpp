@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "EndpointStats.hpp"
+
+/**
+ * @brief keeps track of the live senders and receivers so their statistics
+ * can be collected in one place, eg. for the metrics exporter
+ * @details the endpoints add themselves when constructed and remove
+ * themselves first thing in the destructor. collect holds the registry lock
+ * while it asks the endpoints for their stats, so once remove returns the
+ * endpoint is not called anymore
+ */
+class StatsRegistry {
+public:
+  struct Entry {
+    size_t id;
+    std::string kind; // "sender" or "receiver"
+    std::string name; // the sender name or the output of the receiver
+    EndpointStatsSnapshot stats;
+  };
+
+  using NameFunc = std::function<std::string()>;
+  using StatsFunc = std::function<EndpointStatsSnapshot()>;
+
+  /**
+   * @returns id for remove
+   */
+  static size_t add(const std::string &kind, NameFunc name, StatsFunc stats);
+
+  static void remove(size_t id);
+
+  /**
+   * @returns the stats of every live endpoint in the order they were added
+   */
+  static std::vector<Entry> collect();
+
+private:
+  struct Endpoint {
+    std::string kind;
+    NameFunc name;
+    StatsFunc stats;
+  };
+
+  static std::mutex mutex_;
+  static std::map<size_t, Endpoint> endpoints_;
+  static size_t nextId_;
+};
@@ -6,6 +6,9 @@
 #pragma once
 #include <condition_variable>
 #include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
 
 class ThreadPool {
 public:
@@ -14,6 +17,23 @@ public:
 
     void enqueue(std::function<void()> job);
 
+    // Add a new job and get its result or exception through the future
+    template <typename F>
+    auto submit(F&& job) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+        // std::function needs a copyable target, so the task is shared
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+        auto future = task->get_future();
+        enqueue([task]() { (*task)(); });
+        return future;
+    }
+
+    // Number of jobs waiting for a free thread
+    size_t queueSize();
+
+    // Number of worker threads
+    size_t threadCount() const { return numThreads_; }
+
 private:
     // Worker function for each thread
     void worker();
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief scoped timing of the hot paths, exported as chrome trace json that
+ * chrome://tracing and perfetto open
+ * @details the macros compile to nothing unless the library is built with
+ * NDIWRAPPER_ENABLE_TRACING, so a normal build pays nothing for them. When
+ * enabled every thread records to its own fixed size ring without locks or
+ * allocation, the oldest events are overwritten when the ring is full. The
+ * ring of a finished thread goes to the next new thread, so the memory is
+ * bounded by the most threads alive at once and not by every thread ever. The
+ * names and categories must be string literals since only the pointers are
+ * stored
+ *
+ * NDIW_TRACE_SCOPE("capture"); records from here to the end of the scope
+ */
+namespace Trace {
+/**
+ * @brief how many events each thread keeps
+ */
+constexpr size_t kEventsPerThread = 16384;
+
+/**
+ * @returns nanoseconds on the steady clock since the first call
+ */
+int64_t now();
+
+/**
+ * @brief stores an event to the ring of the calling thread
+ */
+void record(const char *name, const char *category, int64_t startNs,
+            int64_t endNs);
+
+/**
+ * @brief turns the recording on and off at runtime, on by default when the
+ * tracing is compiled in
+ */
+void setEnabled(bool enabled);
+bool isEnabled();
+
+/**
+ * @brief forgets the recorded events of every thread
+ */
+void clear();
+
+/**
+ * @returns the recorded events of every thread as chrome trace json, can be
+ * called while the threads keep recording
+ */
+std::string chromeTraceJson();
+
+/**
+ * @brief writes chromeTraceJson to the file
+ * @returns false if the file could not be written
+ */
+bool writeChromeTrace(const std::string &path);
+
+/**
+ * @brief records the time from construction to destruction
+ */
+class ScopedEvent {
+public:
+  ScopedEvent(const char *name, const char *category)
+      : name_(name), category_(category), start_(isEnabled() ? now() : -1) {}
+  ~ScopedEvent() {
+    if (start_ >= 0) {
+      record(name_, category_, start_, now());
+    }
+  }
+
+  ScopedEvent(const ScopedEvent &) = delete;
+  ScopedEvent &operator=(const ScopedEvent &) = delete;
+
+private:
+  const char *name_;
+  const char *category_;
+  int64_t start_;
+};
+} // namespace Trace
+
+#define NDIW_TRACE_CONCAT_INNER(a, b) a##b
+#define NDIW_TRACE_CONCAT(a, b) NDIW_TRACE_CONCAT_INNER(a, b)
+
+#ifdef NDIWRAPPER_ENABLE_TRACING
+#define NDIW_TRACE_SCOPE_CATEGORY(name, category)                              \
+  ::Trace::ScopedEvent NDIW_TRACE_CONCAT(ndiwTraceScope, __LINE__)(name,       \
+                                                                   category)
+#else
+#define NDIW_TRACE_SCOPE_CATEGORY(name, category) ((void)0)
+#endif
+
+#define NDIW_TRACE_SCOPE(name) NDIW_TRACE_SCOPE_CATEGORY(name, "ndiwrapper")
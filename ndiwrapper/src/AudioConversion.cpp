@@ -0,0 +1,235 @@
+#include "AudioConversion.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NDIW_AUDIO_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace AudioConversion {
+namespace {
+constexpr float kInt16Scale = 32767.0f;
+constexpr float kInt24Scale = 8388607.0f;
+
+inline float clampSample(float sample) {
+  return std::min(1.0f, std::max(-1.0f, sample));
+}
+
+inline int16_t toInt16(float sample) {
+  // rounds half away from zero where the simd path rounds half to even, they
+  // differ only when the scaled sample is exactly halfway
+  float scaled = clampSample(sample) * kInt16Scale;
+  return static_cast<int16_t>(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
+
+inline void storeInt24(float sample, uint8_t *dst) {
+  float scaled = clampSample(sample) * kInt24Scale;
+  int32_t value =
+      static_cast<int32_t>(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+  dst[0] = static_cast<uint8_t>(value);
+  dst[1] = static_cast<uint8_t>(value >> 8);
+  dst[2] = static_cast<uint8_t>(value >> 16);
+}
+
+inline float sampleAt(const float *plane, int i) {
+  return plane ? plane[i] : 0.0f;
+}
+
+#ifdef NDIW_AUDIO_SSE2
+inline __m128i toInt16Lanes(__m128 samples) {
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 minusOne = _mm_set1_ps(-1.0f);
+  samples = _mm_min_ps(one, _mm_max_ps(minusOne, samples));
+  return _mm_cvtps_epi32(_mm_mul_ps(samples, _mm_set1_ps(kInt16Scale)));
+}
+#endif
+
+std::vector<const float *> makePlanes(const float *data, int channels,
+                                      size_t channelStride,
+                                      const std::vector<int> &channelMap) {
+  std::vector<const float *> result;
+  if (!data) {
+    result.assign(channelMap.empty() ? channels : channelMap.size(), nullptr);
+    return result;
+  }
+  if (channelMap.empty()) {
+    result.reserve(channels);
+    for (int c = 0; c < channels; c++) {
+      result.push_back(data + channelStride * c);
+    }
+    return result;
+  }
+  result.reserve(channelMap.size());
+  for (int source : channelMap) {
+    result.push_back(source >= 0 && source < channels
+                         ? data + channelStride * source
+                         : nullptr);
+  }
+  return result;
+}
+} // namespace
+
+std::vector<const float *> planes(const NDIlib_audio_frame_v2_t &frame,
+                                  const std::vector<int> &channelMap) {
+  // the stride is in bytes and may be larger than the samples of a channel
+  size_t channelStride = frame.channel_stride_in_bytes > 0
+                             ? frame.channel_stride_in_bytes / sizeof(float)
+                             : static_cast<size_t>(frame.no_samples);
+  return makePlanes(frame.p_data,
+                    frame.no_channels, channelStride, channelMap);
+}
+
+std::vector<const float *> planes(const common_types::Audio &audio,
+                                  const std::vector<int> &channelMap) {
+  return makePlanes(audio.data.empty() ? nullptr : audio.data.data(),
+                    audio.channels, static_cast<size_t>(audio.noSamples),
+                    channelMap);
+}
+
+void copyPlanar(const float *const *planes, int channels, int samples,
+                float *dst) {
+  for (int c = 0; c < channels; c++) {
+    float *channel = dst + static_cast<size_t>(samples) * c;
+    if (planes[c]) {
+      std::memcpy(channel, planes[c], sizeof(float) * samples);
+    } else {
+      std::fill(channel, channel + samples, 0.0f);
+    }
+  }
+}
+
+void interleave(const float *const *planes, int channels, int samples,
+                float *dst) {
+  int i = 0;
+#ifdef NDIW_AUDIO_SSE2
+  if (channels == 2 && planes[0] && planes[1]) {
+    for (; i + 4 <= samples; i += 4) {
+      __m128 left = _mm_loadu_ps(planes[0] + i);
+      __m128 right = _mm_loadu_ps(planes[1] + i);
+      _mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(left, right));
+      _mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(left, right));
+    }
+  }
+#endif
+  for (; i < samples; i++) {
+    for (int c = 0; c < channels; c++) {
+      dst[static_cast<size_t>(i) * channels + c] = sampleAt(planes[c], i);
+    }
+  }
+}
+
+void interleaveToInt16(const float *const *planes, int channels, int samples,
+                       int16_t *dst) {
+  int i = 0;
+#ifdef NDIW_AUDIO_SSE2
+  if (channels == 2 && planes[0] && planes[1]) {
+    for (; i + 4 <= samples; i += 4) {
+      __m128i left = toInt16Lanes(_mm_loadu_ps(planes[0] + i));
+      __m128i right = toInt16Lanes(_mm_loadu_ps(planes[1] + i));
+      // l0 r0 l1 r1 | l2 r2 l3 r3, packed with saturation to 8 int16
+      __m128i low = _mm_unpacklo_epi32(left, right);
+      __m128i high = _mm_unpackhi_epi32(left, right);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * i),
+                       _mm_packs_epi32(low, high));
+    }
+  } else if (channels == 1 && planes[0]) {
+    floatToInt16(planes[0], static_cast<size_t>(samples), dst);
+    return;
+  }
+#endif
+  for (; i < samples; i++) {
+    for (int c = 0; c < channels; c++) {
+      dst[static_cast<size_t>(i) * channels + c] =
+          toInt16(sampleAt(planes[c], i));
+    }
+  }
+}
+
+void interleaveToInt24(const float *const *planes, int channels, int samples,
+                       uint8_t *dst) {
+  // 3 byte samples do not fit the simd lanes, the clamp and scale is cheap
+  // next to the byte stores anyway
+  for (int i = 0; i < samples; i++) {
+    for (int c = 0; c < channels; c++) {
+      storeInt24(sampleAt(planes[c], i),
+                 dst + (static_cast<size_t>(i) * channels + c) * 3);
+    }
+  }
+}
+
+void floatToInt16(const float *src, size_t count, int16_t *dst) {
+  size_t i = 0;
+#ifdef NDIW_AUDIO_SSE2
+  for (; i + 8 <= count; i += 8) {
+    __m128i low = toInt16Lanes(_mm_loadu_ps(src + i));
+    __m128i high = toInt16Lanes(_mm_loadu_ps(src + i + 4));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                     _mm_packs_epi32(low, high));
+  }
+#endif
+  for (; i < count; i++) {
+    dst[i] = toInt16(src[i]);
+  }
+}
+
+void floatToInt24(const float *src, size_t count, uint8_t *dst) {
+  for (size_t i = 0; i < count; i++) {
+    storeInt24(src[i], dst + i * 3);
+  }
+}
+
+void toAudio(const NDIlib_audio_frame_v2_t &frame, const AudioFormat &format,
+             common_types::Audio &audio) {
+  auto channels = planes(frame, format.channelMap);
+  audio.sampleRate = frame.sample_rate;
+  audio.channels = static_cast<int>(channels.size());
+  audio.noSamples = frame.no_samples;
+  audio.data.resize(static_cast<size_t>(audio.channels) * frame.no_samples);
+  if (format.layout == AudioLayout::Interleaved) {
+    interleave(channels.data(), audio.channels, frame.no_samples,
+               audio.data.data());
+  } else {
+    copyPlanar(channels.data(), audio.channels, frame.no_samples,
+               audio.data.data());
+  }
+  audio.isNew = true;
+  audio.timestamp = frame.timestamp * 100;
+}
+
+void toAudio16(const common_types::Audio &audio, AudioLayout layout,
+               common_types::Audio16 &audio16) {
+  audio16.sampleRate = audio.sampleRate;
+  audio16.channels = audio.channels;
+  audio16.noSamples = audio.noSamples;
+  audio16.data.resize(static_cast<size_t>(audio.channels) * audio.noSamples);
+  if (layout == AudioLayout::Interleaved) {
+    floatToInt16(audio.data.data(), audio16.data.size(), audio16.data.data());
+  } else {
+    auto channels = planes(audio);
+    interleaveToInt16(channels.data(), audio.channels, audio.noSamples,
+                      audio16.data.data());
+  }
+  audio16.isNew = audio.isNew;
+  audio16.timestamp = audio.timestamp;
+}
+
+void toAudio24(const common_types::Audio &audio, AudioLayout layout,
+               Audio24 &audio24) {
+  audio24.sampleRate = audio.sampleRate;
+  audio24.channels = audio.channels;
+  audio24.noSamples = audio.noSamples;
+  size_t count = static_cast<size_t>(audio.channels) * audio.noSamples;
+  audio24.data.resize(count * 3);
+  if (layout == AudioLayout::Interleaved) {
+    floatToInt24(audio.data.data(), count, audio24.data.data());
+  } else {
+    auto channels = planes(audio);
+    interleaveToInt24(channels.data(), audio.channels, audio.noSamples,
+                      audio24.data.data());
+  }
+  audio24.timestamp = audio.timestamp;
+}
+} // namespace AudioConversion
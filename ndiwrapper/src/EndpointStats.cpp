@@ -0,0 +1,77 @@
+#include "EndpointStats.hpp"
+
+namespace {
+size_t bucketOf(uint64_t micros) {
+  size_t bucket = 0;
+  while (micros > 0 && bucket < LatencyHistogram::kBuckets - 1) {
+    micros >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+} // namespace
+
+uint64_t LatencyHistogram::Snapshot::bucketUpperBoundUs(size_t bucket) {
+  return uint64_t(1) << bucket;
+}
+
+uint64_t LatencyHistogram::Snapshot::quantileUs(double quantile) const {
+  if (count == 0) {
+    return 0;
+  }
+  // the buckets are read one by one while recording goes on, so their sum
+  // can differ a little from count
+  uint64_t total = 0;
+  for (auto bucket : buckets) {
+    total += bucket;
+  }
+  uint64_t rank = static_cast<uint64_t>(quantile * total);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBuckets; i++) {
+    seen += buckets[i];
+    if (seen > rank) {
+      return bucketUpperBoundUs(i);
+    }
+  }
+  return bucketUpperBoundUs(kBuckets - 1);
+}
+
+double LatencyHistogram::Snapshot::meanUs() const {
+  return count == 0 ? 0.0 : static_cast<double>(sumUs) / count;
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds duration) {
+  uint64_t micros = duration.count() > 0
+                        ? static_cast<uint64_t>(duration.count()) / 1000
+                        : 0;
+  buckets_[bucketOf(micros)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sumUs_.fetch_add(micros, std::memory_order_relaxed);
+  uint64_t max = maxUs_.load(std::memory_order_relaxed);
+  while (micros > max && !maxUs_.compare_exchange_weak(
+                             max, micros, std::memory_order_relaxed)) {
+  }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+  Snapshot snapshot;
+  for (size_t i = 0; i < kBuckets; i++) {
+    snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+  snapshot.count = count_.load(std::memory_order_relaxed);
+  snapshot.sumUs = sumUs_.load(std::memory_order_relaxed);
+  snapshot.maxUs = maxUs_.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+EndpointStatsSnapshot EndpointStats::snapshot() const {
+  EndpointStatsSnapshot snapshot;
+  snapshot.videoFrames = videoFrames.load(std::memory_order_relaxed);
+  snapshot.audioFrames = audioFrames.load(std::memory_order_relaxed);
+  snapshot.metadataFrames = metadataFrames.load(std::memory_order_relaxed);
+  snapshot.callbackLatency = callbackLatency.snapshot();
+  snapshot.copyTime = copyTime.snapshot();
+  snapshot.scaleTime = scaleTime.snapshot();
+  snapshot.metadataDecodeTime = metadataDecodeTime.snapshot();
+  return snapshot;
+}
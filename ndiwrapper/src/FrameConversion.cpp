@@ -0,0 +1,61 @@
+#include "FrameConversion.hpp"
+
+#include <cstring>
+
+#include "AudioConversion.hpp"
+#include "MetaData.hpp"
+
+namespace FrameConversion {
+namespace {
+constexpr int kBytesPerPixel = 4;
+}
+
+int64_t frameDuration(const NDIlib_video_frame_v2_t &frame) {
+  if (frame.frame_rate_N <= 0 || frame.frame_rate_D <= 0) {
+    return 0;
+  }
+  return 10000000LL * frame.frame_rate_D / frame.frame_rate_N;
+}
+
+void toImage(const NDIlib_video_frame_v2_t &frame, common_types::Image &image) {
+  image.width = frame.xres;
+  image.height = frame.yres;
+  image.channels = kBytesPerPixel; // Assuming RGBA format
+  image.stride = frame.xres * kBytesPerPixel;
+  image.timestamp = frame.timestamp * 100;
+
+  size_t rowBytes = static_cast<size_t>(image.stride);
+  if (frame.line_stride_in_bytes == image.stride || frame.yres <= 1) {
+    image.data.assign(frame.p_data, frame.p_data + rowBytes * frame.yres);
+    return;
+  }
+  image.data.resize(rowBytes * frame.yres);
+  size_t lineStride = static_cast<size_t>(frame.line_stride_in_bytes);
+  for (int y = 0; y < frame.yres; y++) {
+    std::memcpy(image.data.data() + rowBytes * y,
+                frame.p_data + lineStride * y, rowBytes);
+  }
+}
+
+DataWithMetadata<common_types::Image>
+toImageWithMetadata(const NDIlib_video_frame_v2_t &frame, bool copyPixels) {
+  DataWithMetadata<common_types::Image> fullframe;
+  if (copyPixels) {
+    toImage(frame, fullframe.data);
+  } else {
+    fullframe.data.width = frame.xres;
+    fullframe.data.height = frame.yres;
+    fullframe.data.channels = kBytesPerPixel;
+    fullframe.data.stride = frame.xres * kBytesPerPixel;
+    fullframe.data.timestamp = frame.timestamp * 100;
+  }
+  if (frame.p_metadata && Metadata::isEncodedMetadata(frame.p_metadata)) {
+    fullframe.metadata = Metadata::decode(frame.p_metadata);
+  }
+  return fullframe;
+}
+
+void toAudio(const NDIlib_audio_frame_v2_t &frame, common_types::Audio &audio) {
+  AudioConversion::toAudio(frame, AudioFormat{}, audio);
+}
+} // namespace FrameConversion
@@ -0,0 +1,308 @@
+#include "FrameRecorder.hpp"
+#include "NDIWLog.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+using namespace FrameRecording;
+
+namespace {
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+size_t metadataLength(const char *metadata) {
+  return metadata ? std::strlen(metadata) + 1 : 0;
+}
+
+size_t audioPayloadSize(const NDIlib_audio_frame_v2_t &frame) {
+  size_t channelStride =
+      frame.channel_stride_in_bytes > 0
+          ? static_cast<size_t>(frame.channel_stride_in_bytes)
+          : static_cast<size_t>(frame.no_samples) * sizeof(float);
+  return channelStride * static_cast<size_t>(std::max(frame.no_channels, 0));
+}
+
+/**
+ * @returns the size of the recording file for the options
+ * @throws std::runtime_error before anything touches the file if the options
+ * leave no room for frames
+ */
+uint64_t recordingFileSize(const FrameRecorder::Options &options) {
+  if (options.indexEntries == 0 || options.dataBytes == 0) {
+    throw std::runtime_error("A recording needs room for frames");
+  }
+  if (options.indexEntries > UINT64_MAX / 2 / sizeof(IndexEntry) ||
+      options.dataBytes > UINT64_MAX / 2) {
+    throw std::runtime_error("The recording is too large");
+  }
+  return alignUp(sizeof(FileHeader) + options.indexEntries * sizeof(IndexEntry),
+                 kRecordAlignment) +
+         alignUp(options.dataBytes, kRecordAlignment);
+}
+} // namespace
+
+size_t FrameRecording::videoPayloadSize(const NDIlib_video_frame_v2_t &frame) {
+  size_t stride = static_cast<size_t>(std::max(frame.line_stride_in_bytes, 0));
+  size_t width = static_cast<size_t>(std::max(frame.xres, 0));
+  size_t height = static_cast<size_t>(std::max(frame.yres, 0));
+  switch (frame.FourCC) {
+  case NDIlib_FourCC_video_type_UYVY:
+  case NDIlib_FourCC_video_type_BGRA:
+  case NDIlib_FourCC_video_type_BGRX:
+  case NDIlib_FourCC_video_type_RGBA:
+  case NDIlib_FourCC_video_type_RGBX:
+    return stride * height;
+  // the chroma is half the height of the luma
+  case NDIlib_FourCC_video_type_NV12:
+  case NDIlib_FourCC_video_type_I420:
+  case NDIlib_FourCC_video_type_YV12:
+    return stride * height * 3 / 2;
+  // UYVY followed by an 8 bit alpha plane
+  case NDIlib_FourCC_video_type_UYVA:
+    return stride * height + width * height;
+  // 16 bit luma and interleaved chroma, PA16 adds a 16 bit alpha plane
+  case NDIlib_FourCC_video_type_P216:
+    return stride * height * 2;
+  case NDIlib_FourCC_video_type_PA16:
+    return stride * height * 3;
+  default:
+    return 0;
+  }
+}
+
+FrameRecorder::FrameRecorder(const std::string &path, const Options &options)
+    : path_(path), file_(path, MappedFile::Mode::Create,
+                         recordingFileSize(options)) {
+  // the file is created zeroed so only the header needs to be written
+  header_ = new (file_.data()) FileHeader();
+  std::memcpy(header_->magic, kMagic, sizeof(kMagic));
+  header_->version = kVersion;
+  header_->headerSize = sizeof(FileHeader);
+  header_->indexCapacity = options.indexEntries;
+  header_->dataCapacity = alignUp(options.dataBytes, kRecordAlignment);
+  header_->indexOffset = sizeof(FileHeader);
+  header_->dataOffset = file_.size() - header_->dataCapacity;
+  index_ = reinterpret_cast<IndexEntry *>(file_.data() + header_->indexOffset);
+  data_ = file_.data() + header_->dataOffset;
+  NDIW_LOG_INFO("Recording frames to", path_);
+}
+
+bool FrameRecorder::recordVideo(const NDIlib_video_frame_v2_t &frame) {
+  size_t payloadSize = videoPayloadSize(frame);
+  if (payloadSize == 0 || !frame.p_data) {
+    NDIW_LOG_WARN_EVERY(5000, "Not recording video frame with FourCC",
+                        static_cast<uint32_t>(frame.FourCC));
+    return false;
+  }
+  IndexEntry entry{};
+  entry.type = static_cast<uint32_t>(FrameType::Video);
+  entry.timecode = frame.timecode;
+  entry.timestamp = frame.timestamp;
+  entry.fourCC = static_cast<uint32_t>(frame.FourCC);
+  entry.width = frame.xres;
+  entry.height = frame.yres;
+  entry.stride = frame.line_stride_in_bytes;
+  entry.frameRateN = frame.frame_rate_N;
+  entry.frameRateD = frame.frame_rate_D;
+  entry.frameFormat = static_cast<int32_t>(frame.frame_format_type);
+  entry.aspectRatio = frame.picture_aspect_ratio;
+  return append(entry, frame.p_data, payloadSize, frame.p_metadata);
+}
+
+bool FrameRecorder::recordAudio(const NDIlib_audio_frame_v2_t &frame) {
+  if (!frame.p_data) {
+    return false;
+  }
+  IndexEntry entry{};
+  entry.type = static_cast<uint32_t>(FrameType::Audio);
+  entry.timecode = frame.timecode;
+  entry.timestamp = frame.timestamp;
+  entry.stride = frame.channel_stride_in_bytes > 0
+                     ? frame.channel_stride_in_bytes
+                     : frame.no_samples * static_cast<int>(sizeof(float));
+  entry.sampleRate = frame.sample_rate;
+  entry.channels = frame.no_channels;
+  entry.samples = frame.no_samples;
+  return append(entry, frame.p_data, audioPayloadSize(frame),
+                frame.p_metadata);
+}
+
+bool FrameRecorder::recordMetadata(const NDIlib_metadata_frame_t &frame) {
+  if (!frame.p_data) {
+    return false;
+  }
+  IndexEntry entry{};
+  entry.type = static_cast<uint32_t>(FrameType::Metadata);
+  entry.timecode = frame.timecode;
+  return append(entry, frame.p_data, metadataLength(frame.p_data), nullptr);
+}
+
+bool FrameRecorder::record(const FrameView &frame) {
+  IndexEntry entry = frame.entry;
+  return append(entry, frame.payload, frame.entry.payloadSize, frame.metadata);
+}
+
+bool FrameRecorder::append(IndexEntry &entry, const void *payload,
+                           size_t payloadSize, const char *metadata) {
+  size_t metadataSize = metadataLength(metadata);
+  uint64_t recordSize = alignUp(payloadSize + metadataSize, kRecordAlignment);
+  uint64_t capacity = header_->dataCapacity;
+  if (recordSize > capacity || payloadSize > UINT32_MAX) {
+    NDIW_LOG_ERROR_EVERY(5000, "Frame of", payloadSize,
+                         "bytes does not fit the recording of", capacity,
+                         "bytes");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(writeMutex_);
+  uint64_t position = header_->dataHead.load(std::memory_order_relaxed);
+  uint64_t offset = position % capacity;
+  if (offset + recordSize > capacity) {
+    position += capacity - offset;
+    offset = 0;
+  }
+  uint64_t seq = header_->writeCount.load(std::memory_order_relaxed);
+  // readers treat everything the new head has lapped and the reserved slot as
+  // gone before a byte of them is changed
+  header_->dataHead.store(position + recordSize, std::memory_order_relaxed);
+  header_->writeCount.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  std::memcpy(data_ + offset, payload, payloadSize);
+  if (metadataSize > 0) {
+    std::memcpy(data_ + offset + payloadSize, metadata, metadataSize);
+  }
+  entry.seq = seq;
+  entry.dataPosition = position;
+  entry.payloadSize = static_cast<uint32_t>(payloadSize);
+  entry.metadataSize = static_cast<uint32_t>(metadataSize);
+  index_[seq % header_->indexCapacity] = entry;
+
+  header_->commitCount.store(seq + 1, std::memory_order_release);
+  return true;
+}
+
+void FrameRecorder::discardLast() {
+  std::lock_guard<std::mutex> lock(writeMutex_);
+  uint64_t committed = header_->commitCount.load(std::memory_order_relaxed);
+  if (committed > 0) {
+    index_[(committed - 1) % header_->indexCapacity].seq = UINT64_MAX;
+  }
+}
+
+void FrameRecorder::flush() { file_.flush(); }
+
+uint64_t FrameRecorder::framesWritten() const {
+  return header_->commitCount.load(std::memory_order_acquire);
+}
+
+FrameRecordingReader::FrameRecordingReader(const std::string &path)
+    : file_(path, MappedFile::Mode::ReadOnly) {
+  header_ = reinterpret_cast<const FileHeader *>(file_.data());
+  if (file_.size() < sizeof(FileHeader) ||
+      std::memcmp(header_->magic, kMagic, sizeof(kMagic)) != 0 ||
+      header_->version != kVersion) {
+    throw std::runtime_error(path + " is not a frame recording");
+  }
+  if (header_->indexCapacity == 0 || header_->dataCapacity == 0) {
+    throw std::runtime_error(path + " has no room for frames");
+  }
+  // written as divisions and subtractions so a corrupt header can not
+  // overflow its way past the checks
+  if (header_->indexOffset < sizeof(FileHeader) ||
+      header_->indexOffset > header_->dataOffset ||
+      header_->indexCapacity > (header_->dataOffset - header_->indexOffset) /
+                                   sizeof(IndexEntry) ||
+      header_->dataOffset > file_.size() ||
+      header_->dataCapacity > file_.size() - header_->dataOffset) {
+    throw std::runtime_error(path + " is truncated");
+  }
+  index_ = reinterpret_cast<const IndexEntry *>(file_.data() +
+                                                header_->indexOffset);
+  data_ = file_.data() + header_->dataOffset;
+}
+
+std::vector<FrameView> FrameRecordingReader::frames(int64_t fromTimecode,
+                                                    int64_t toTimecode) const {
+  std::vector<FrameView> result;
+  uint64_t committed = header_->commitCount.load(std::memory_order_acquire);
+  uint64_t capacity = header_->indexCapacity;
+  uint64_t first = committed > capacity ? committed - capacity : 0;
+  for (uint64_t seq = first; seq < committed; ++seq) {
+    FrameView view;
+    view.entry = index_[seq % capacity];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // the slot has been taken by a newer frame while it was copied
+    if (header_->writeCount.load(std::memory_order_relaxed) > seq + capacity ||
+        view.entry.seq != seq) {
+      continue;
+    }
+    if (view.entry.timecode < fromTimecode ||
+        view.entry.timecode > toTimecode) {
+      continue;
+    }
+    const uint8_t *record =
+        data_ + view.entry.dataPosition % header_->dataCapacity;
+    view.payload = record;
+    if (view.entry.metadataSize > 0) {
+      view.metadata =
+          reinterpret_cast<const char *>(record + view.entry.payloadSize);
+    }
+    if (intact(view)) {
+      result.push_back(view);
+    }
+  }
+  return result;
+}
+
+int64_t FrameRecordingReader::latestTimecode() const {
+  uint64_t committed = header_->commitCount.load(std::memory_order_acquire);
+  if (committed == 0) {
+    return 0;
+  }
+  return index_[(committed - 1) % header_->indexCapacity].timecode;
+}
+
+bool FrameRecordingReader::intact(const FrameView &frame) const {
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return header_->dataHead.load(std::memory_order_relaxed) <=
+         frame.entry.dataPosition + header_->dataCapacity;
+}
+
+int64_t FrameRecordingReader::extract(int64_t fromTimecode, int64_t toTimecode,
+                                      const std::string &outPath) const {
+  std::vector<FrameView> range = frames(fromTimecode, toTimecode);
+  FrameRecorder::Options options;
+  options.indexEntries = std::max<size_t>(range.size(), 1);
+  options.dataBytes = kRecordAlignment;
+  for (const FrameView &frame : range) {
+    options.dataBytes += alignUp(
+        uint64_t(frame.entry.payloadSize) + frame.entry.metadataSize,
+        kRecordAlignment);
+  }
+  try {
+    FrameRecorder out(outPath, options);
+    int64_t written = 0;
+    for (const FrameView &frame : range) {
+      if (!out.record(frame)) {
+        continue;
+      }
+      // the recorder overwrote the frame while it was copied
+      if (!intact(frame)) {
+        NDIW_LOG_WARN("Frame", frame.entry.seq,
+                      "was overwritten while it was extracted");
+        out.discardLast();
+        continue;
+      }
+      ++written;
+    }
+    out.flush();
+    return written;
+  } catch (const std::exception &e) {
+    NDIW_LOG_ERROR("Could not extract the recording", e.what());
+    return -1;
+  }
+}
@@ -0,0 +1,163 @@
+#include "FrameReplayer.hpp"
+#include "NDIWLog.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+using namespace FrameRecording;
+
+namespace {
+// the longest the replayer sleeps before it looks at stop again
+constexpr std::chrono::milliseconds kMaxSleep(50);
+} // namespace
+
+FrameReplayer::FrameReplayer(const std::string &path,
+                             std::shared_ptr<NDISender> sender,
+                             const Options &options)
+    : reader_(path), sender_(std::move(sender)), options_(options) {
+  if (!sender_) {
+    throw std::runtime_error("Replaying needs a sender");
+  }
+  for (const FrameView &frame :
+       reader_.frames(options_.fromTimecode, options_.toTimecode)) {
+    bool wanted = (frame.type() == FrameType::Video && options_.video) ||
+                  (frame.type() == FrameType::Audio && options_.audio) ||
+                  (frame.type() == FrameType::Metadata && options_.metadata);
+    if (wanted) {
+      frames_.push_back(frame);
+    }
+  }
+  NDIW_LOG_INFO("Replaying", frames_.size(), "frames from", path);
+}
+
+FrameReplayer::~FrameReplayer() {
+  stop();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  // the last async video frame points into the mapping
+  sender_->flushAsync();
+}
+
+void FrameReplayer::start() {
+  if (running_.exchange(true)) {
+    NDIW_LOG_WARN("replayer already running");
+    return;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  stopRequested_ = false;
+  thread_ = std::thread([this]() {
+    try {
+      run();
+    } catch (const std::exception &e) {
+      NDIW_LOG_ERROR("Replaying failed", e.what());
+      running_ = false;
+    }
+  });
+}
+
+void FrameReplayer::stop() { stopRequested_ = true; }
+
+int64_t FrameReplayer::duration() const {
+  if (frames_.empty()) {
+    return 0;
+  }
+  return frames_.back().entry.timecode - frames_.front().entry.timecode;
+}
+
+void FrameReplayer::run() {
+  running_ = true;
+  if (frames_.empty()) {
+    running_ = false;
+    return;
+  }
+  // on loops the timecodes continue one video frame after the last frame
+  int64_t roundLength = duration();
+  for (auto it = frames_.rbegin(); it != frames_.rend(); ++it) {
+    if (it->type() == FrameType::Video && it->entry.frameRateN > 0) {
+      roundLength += int64_t(10000000) * it->entry.frameRateD /
+                     it->entry.frameRateN;
+      break;
+    }
+  }
+
+  using Clock = std::chrono::steady_clock;
+  const int64_t firstTimecode = frames_.front().entry.timecode;
+  const Clock::time_point start = Clock::now();
+  int64_t timecodeOffset = 0;
+  do {
+    for (const FrameView &frame : frames_) {
+      if (stopRequested_) {
+        break;
+      }
+      if (options_.speed > 0) {
+        // timecodes are in 100 ns units
+        double sinceStart = double(frame.entry.timecode - firstTimecode +
+                                   timecodeOffset) *
+                            100.0 / options_.speed;
+        auto deadline =
+            start + std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double, std::nano>(sinceStart));
+        for (auto now = Clock::now(); now < deadline && !stopRequested_;
+             now = Clock::now()) {
+          std::this_thread::sleep_for(
+              std::min<Clock::duration>(deadline - now, kMaxSleep));
+        }
+      }
+      send(frame, timecodeOffset);
+    }
+    timecodeOffset += roundLength;
+  } while (options_.loop && !stopRequested_);
+
+  sender_->flushAsync();
+  running_ = false;
+}
+
+void FrameReplayer::send(const FrameView &frame, int64_t timecodeOffset) {
+  NDIW_TRACE_SCOPE("replay frame");
+  const IndexEntry &entry = frame.entry;
+  switch (frame.type()) {
+  case FrameType::Video: {
+    NDIlib_video_frame_v2_t video;
+    video.xres = entry.width;
+    video.yres = entry.height;
+    video.FourCC = static_cast<NDIlib_FourCC_video_type_e>(entry.fourCC);
+    video.frame_rate_N = entry.frameRateN;
+    video.frame_rate_D = entry.frameRateD;
+    video.picture_aspect_ratio = entry.aspectRatio;
+    video.frame_format_type =
+        static_cast<NDIlib_frame_format_type_e>(entry.frameFormat);
+    video.timecode = entry.timecode + timecodeOffset;
+    // the sdk only reads the frame, the mapping is read only
+    video.p_data = const_cast<uint8_t *>(frame.payload);
+    video.line_stride_in_bytes = entry.stride;
+    video.p_metadata = frame.metadata;
+    sender_->feedVideoFrame(video, true);
+    break;
+  }
+  case FrameType::Audio: {
+    NDIlib_audio_frame_v2_t audio;
+    audio.sample_rate = entry.sampleRate;
+    audio.no_channels = entry.channels;
+    audio.no_samples = entry.samples;
+    audio.timecode = entry.timecode + timecodeOffset;
+    audio.p_data =
+        const_cast<float *>(reinterpret_cast<const float *>(frame.payload));
+    audio.channel_stride_in_bytes = entry.stride;
+    audio.p_metadata = frame.metadata;
+    sender_->feedAudioFrame(audio);
+    break;
+  }
+  case FrameType::Metadata:
+    sender_->sendRawMetadata(reinterpret_cast<const char *>(frame.payload),
+                             entry.timecode + timecodeOffset);
+    break;
+  default:
+    return;
+  }
+  framesSent_.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,241 @@
+#include "ImageScaling.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NDIW_IMAGE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace ImageScaling {
+namespace {
+constexpr int kBytesPerPixel = 4;
+
+inline uint32_t loadPixel(const uint8_t *p) {
+  uint32_t pixel;
+  std::memcpy(&pixel, p, sizeof(pixel));
+  return pixel;
+}
+
+inline void storePixel(uint8_t *p, uint32_t pixel) {
+  std::memcpy(p, &pixel, sizeof(pixel));
+}
+
+/**
+ * @brief the source range of each output pixel along one axis, at least one
+ * source pixel even when scaling up
+ */
+void boxRanges(int src, int dst, std::vector<int> &start,
+               std::vector<int> &end) {
+  start.resize(dst);
+  end.resize(dst);
+  for (int i = 0; i < dst; i++) {
+    start[i] = static_cast<int>(int64_t(i) * src / dst);
+    end[i] = std::max(start[i] + 1,
+                      static_cast<int>(int64_t(i + 1) * src / dst));
+  }
+}
+
+/**
+ * @brief the neighbours and the weight of the second one for each output
+ * pixel along one axis, the pixel centers are aligned
+ */
+void bilinearTaps(int src, int dst, std::vector<int> &first,
+                  std::vector<int> &second, std::vector<uint16_t> &weight) {
+  first.resize(dst);
+  second.resize(dst);
+  weight.resize(dst);
+  double ratio = double(src) / dst;
+  for (int i = 0; i < dst; i++) {
+    double position =
+        std::min(std::max((i + 0.5) * ratio - 0.5, 0.0), double(src - 1));
+    int index = static_cast<int>(position);
+    first[i] = index;
+    second[i] = std::min(index + 1, src - 1);
+    weight[i] = static_cast<uint16_t>(std::lround((position - index) * 256));
+  }
+}
+} // namespace
+
+Scaler::Scaler(int width, int height, Filter filter)
+    : width_(std::max(width, 1)), height_(std::max(height, 1)),
+      filter_(filter) {}
+
+void Scaler::prepare(int srcWidth, int srcHeight) {
+  if (srcWidth == srcWidth_ && srcHeight == srcHeight_) {
+    return;
+  }
+  srcWidth_ = srcWidth;
+  srcHeight_ = srcHeight;
+  if (filter_ == Filter::Box) {
+    boxRanges(srcWidth, width_, xStart_, xEnd_);
+    boxRanges(srcHeight, height_, yStart_, yEnd_);
+    xScale_.resize(width_);
+    for (int x = 0; x < width_; x++) {
+      xScale_[x] = 1.0f / float(xEnd_[x] - xStart_[x]);
+    }
+    rowSums_.assign(size_t(width_) * kBytesPerPixel, 0);
+  } else {
+    bilinearTaps(srcWidth, width_, x0_, x1_, xWeight_);
+    bilinearTaps(srcHeight, height_, y0_, y1_, yWeight_);
+  }
+}
+
+void Scaler::scale(const uint8_t *src, int srcWidth, int srcHeight,
+                   int srcStride, uint8_t *dst, int dstStride) {
+  if (!src || srcWidth <= 0 || srcHeight <= 0) {
+    return;
+  }
+  prepare(srcWidth, srcHeight);
+  if (filter_ == Filter::Box) {
+    scaleBox(src, srcStride, dst, dstStride);
+  } else {
+    scaleBilinear(src, srcStride, dst, dstStride);
+  }
+}
+
+void Scaler::scale(const uint8_t *src, int srcWidth, int srcHeight,
+                   int srcStride, common_types::Image &image) {
+  image.width = width_;
+  image.height = height_;
+  image.channels = kBytesPerPixel;
+  image.stride = width_ * kBytesPerPixel;
+  image.data.resize(size_t(image.stride) * height_);
+  scale(src, srcWidth, srcHeight, srcStride, image.data.data(), image.stride);
+}
+
+void Scaler::scaleBox(const uint8_t *src, int srcStride, uint8_t *dst,
+                      int dstStride) {
+  uint32_t *sums = rowSums_.data();
+  for (int y = 0; y < height_; y++) {
+    std::fill(rowSums_.begin(), rowSums_.end(), 0u);
+    // sum the channels of the source block of each output pixel
+    for (int sy = yStart_[y]; sy < yEnd_[y]; sy++) {
+      const uint8_t *row = src + size_t(sy) * srcStride;
+      for (int x = 0; x < width_; x++) {
+        int sx = xStart_[x];
+        int end = xEnd_[x];
+#ifdef NDIW_IMAGE_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc = _mm_setzero_si128();
+        for (; sx + 2 <= end; sx += 2) {
+          // two pixels to 8 16 bit lanes, then both halves to 32 bits
+          __m128i pixels = _mm_unpacklo_epi8(
+              _mm_loadl_epi64(reinterpret_cast<const __m128i *>(
+                  row + sx * kBytesPerPixel)),
+              zero);
+          acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(pixels, zero));
+          acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(pixels, zero));
+        }
+        for (; sx < end; sx++) {
+          __m128i pixel = _mm_unpacklo_epi8(
+              _mm_cvtsi32_si128(
+                  static_cast<int>(loadPixel(row + sx * kBytesPerPixel))),
+              zero);
+          acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(pixel, zero));
+        }
+        __m128i *sum = reinterpret_cast<__m128i *>(sums + x * kBytesPerPixel);
+        _mm_storeu_si128(sum, _mm_add_epi32(_mm_loadu_si128(sum), acc));
+#else
+        uint32_t *sum = sums + x * kBytesPerPixel;
+        for (; sx < end; sx++) {
+          const uint8_t *pixel = row + sx * kBytesPerPixel;
+          sum[0] += pixel[0];
+          sum[1] += pixel[1];
+          sum[2] += pixel[2];
+          sum[3] += pixel[3];
+        }
+#endif
+      }
+    }
+
+    float rows = 1.0f / float(yEnd_[y] - yStart_[y]);
+    uint8_t *out = dst + size_t(y) * dstStride;
+    for (int x = 0; x < width_; x++) {
+      float scale = xScale_[x] * rows;
+#ifdef NDIW_IMAGE_SSE2
+      __m128 average = _mm_mul_ps(
+          _mm_cvtepi32_ps(_mm_loadu_si128(
+              reinterpret_cast<const __m128i *>(sums + x * kBytesPerPixel))),
+          _mm_set1_ps(scale));
+      __m128i packed = _mm_cvtps_epi32(average);
+      packed = _mm_packs_epi32(packed, packed);
+      packed = _mm_packus_epi16(packed, packed);
+      storePixel(out + x * kBytesPerPixel,
+                 static_cast<uint32_t>(_mm_cvtsi128_si32(packed)));
+#else
+      const uint32_t *sum = sums + x * kBytesPerPixel;
+      for (int c = 0; c < kBytesPerPixel; c++) {
+        out[x * kBytesPerPixel + c] =
+            static_cast<uint8_t>(std::min(255.0f, sum[c] * scale + 0.5f));
+      }
+#endif
+    }
+  }
+}
+
+void Scaler::scaleBilinear(const uint8_t *src, int srcStride, uint8_t *dst,
+                           int dstStride) {
+  for (int y = 0; y < height_; y++) {
+    const uint8_t *top = src + size_t(y0_[y]) * srcStride;
+    const uint8_t *bottom = src + size_t(y1_[y]) * srcStride;
+    uint8_t *out = dst + size_t(y) * dstStride;
+    int x = 0;
+#ifdef NDIW_IMAGE_SSE2
+    // two output pixels per round, every product fits 16 bits as
+    // 255 * 256 + 128 < 65536
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(256);
+    const __m128i round = _mm_set1_epi16(128);
+    const __m128i rowWeight =
+        _mm_set1_epi16(static_cast<short>(yWeight_[y]));
+    const __m128i rowWeightInv = _mm_sub_epi16(full, rowWeight);
+    auto gather = [](const uint8_t *row, int a, int b) {
+      return _mm_unpacklo_epi8(
+          _mm_unpacklo_epi32(
+              _mm_cvtsi32_si128(
+                  static_cast<int>(loadPixel(row + a * kBytesPerPixel))),
+              _mm_cvtsi32_si128(
+                  static_cast<int>(loadPixel(row + b * kBytesPerPixel)))),
+          _mm_setzero_si128());
+    };
+    auto lerp = [&](__m128i a, __m128i b, __m128i wInv, __m128i w) {
+      __m128i sum = _mm_add_epi16(_mm_mullo_epi16(a, wInv),
+                                  _mm_mullo_epi16(b, w));
+      return _mm_srli_epi16(_mm_add_epi16(sum, round), 8);
+    };
+    for (; x + 2 <= width_; x += 2) {
+      __m128i wx = _mm_unpacklo_epi64(
+          _mm_set1_epi16(static_cast<short>(xWeight_[x])),
+          _mm_set1_epi16(static_cast<short>(xWeight_[x + 1])));
+      __m128i wxInv = _mm_sub_epi16(full, wx);
+      __m128i upper = lerp(gather(top, x0_[x], x0_[x + 1]),
+                           gather(top, x1_[x], x1_[x + 1]), wxInv, wx);
+      __m128i lower = lerp(gather(bottom, x0_[x], x0_[x + 1]),
+                           gather(bottom, x1_[x], x1_[x + 1]), wxInv, wx);
+      __m128i blended = lerp(upper, lower, rowWeightInv, rowWeight);
+      __m128i pixels = _mm_packus_epi16(blended, zero);
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(out + x * kBytesPerPixel),
+                       pixels);
+    }
+#endif
+    uint32_t wy = yWeight_[y];
+    for (; x < width_; x++) {
+      uint32_t wx = xWeight_[x];
+      const uint8_t *a = top + x0_[x] * kBytesPerPixel;
+      const uint8_t *b = top + x1_[x] * kBytesPerPixel;
+      const uint8_t *c = bottom + x0_[x] * kBytesPerPixel;
+      const uint8_t *d = bottom + x1_[x] * kBytesPerPixel;
+      for (int ch = 0; ch < kBytesPerPixel; ch++) {
+        uint32_t upper = (a[ch] * (256 - wx) + b[ch] * wx + 128) >> 8;
+        uint32_t lower = (c[ch] * (256 - wx) + d[ch] * wx + 128) >> 8;
+        out[x * kBytesPerPixel + ch] =
+            static_cast<uint8_t>((upper * (256 - wy) + lower * wy + 128) >> 8);
+      }
+    }
+  }
+}
+} // namespace ImageScaling
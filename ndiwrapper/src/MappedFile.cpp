@@ -0,0 +1,124 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string &path, Mode mode, size_t size) {
+  bool writable = mode != Mode::ReadOnly;
+  HANDLE file = CreateFileA(
+      path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+      // a reader opens the recording while the recorder still writes it
+      FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+      mode == Mode::Create ? CREATE_ALWAYS : OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error("Failed to open " + path);
+  }
+  if (mode != Mode::Create) {
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+      CloseHandle(file);
+      throw std::runtime_error("Failed to get the size of " + path);
+    }
+    size = static_cast<size_t>(fileSize.QuadPart);
+  }
+  // the mapping of the full size also grows a created file to the size
+  uint64_t mappingSize = size;
+  HANDLE mapping = CreateFileMappingA(
+      file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY,
+      static_cast<DWORD>(mappingSize >> 32), static_cast<DWORD>(mappingSize),
+      NULL);
+  if (!mapping) {
+    CloseHandle(file);
+    throw std::runtime_error("Failed to map " + path);
+  }
+  void *view = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+                             0, 0, size);
+  if (!view) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    throw std::runtime_error("Failed to map a view of " + path);
+  }
+  file_ = file;
+  mapping_ = mapping;
+  data_ = static_cast<uint8_t *>(view);
+  size_ = size;
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_) {
+    CloseHandle(mapping_);
+  }
+  if (file_) {
+    CloseHandle(file_);
+  }
+}
+
+void MappedFile::flush() {
+  if (data_) {
+    FlushViewOfFile(data_, 0);
+  }
+}
+#else
+MappedFile::MappedFile(const std::string &path, Mode mode, size_t size) {
+  bool writable = mode != Mode::ReadOnly;
+  int flags = writable ? O_RDWR : O_RDONLY;
+  if (mode == Mode::Create) {
+    flags |= O_CREAT | O_TRUNC;
+  }
+  int fd = open(path.c_str(), flags, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open " + path);
+  }
+  if (mode == Mode::Create) {
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+      close(fd);
+      throw std::runtime_error("Failed to allocate " + path);
+    }
+  } else {
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+      close(fd);
+      throw std::runtime_error("Failed to get the size of " + path);
+    }
+    size = static_cast<size_t>(info.st_size);
+  }
+  int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  void *data = mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    close(fd);
+    throw std::runtime_error("Failed to map " + path);
+  }
+  fd_ = fd;
+  data_ = static_cast<uint8_t *>(data);
+  size_ = size;
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    munmap(data_, size_);
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+void MappedFile::flush() {
+  if (data_) {
+    msync(data_, size_, MS_ASYNC);
+  }
+}
+#endif
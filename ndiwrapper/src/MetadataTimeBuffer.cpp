@@ -0,0 +1,170 @@
+#include "MetadataTimeBuffer.hpp"
+
+#include <algorithm>
+
+namespace {
+// ndi timecodes are in 100 ns units
+constexpr int64_t kTicksPerMs = 10000;
+
+template <typename T>
+void insertSorted(std::deque<TimedSample<T>> &samples, int64_t timecode,
+                  const T &value, int64_t history) {
+  if (samples.empty() || samples.back().timecode <= timecode) {
+    samples.push_back({timecode, value});
+  } else {
+    // out of order samples are rare, keep the deque sorted anyway
+    auto it = std::upper_bound(samples.begin(), samples.end(), timecode,
+                               [](int64_t t, const TimedSample<T> &sample) {
+                                 return t < sample.timecode;
+                               });
+    samples.insert(it, {timecode, value});
+  }
+  int64_t oldest = samples.back().timecode - history;
+  while (!samples.empty() && samples.front().timecode < oldest) {
+    samples.pop_front();
+  }
+}
+
+template <typename T>
+std::vector<TimedSample<T>> samplesBetween(
+    const std::deque<TimedSample<T>> &samples, int64_t start, int64_t end) {
+  std::vector<TimedSample<T>> result;
+  if (samples.empty()) {
+    return result;
+  }
+  auto first = std::lower_bound(samples.begin(), samples.end(), start,
+                                [](const TimedSample<T> &sample, int64_t t) {
+                                  return sample.timecode < t;
+                                });
+  auto last = std::upper_bound(first, samples.end(), end,
+                               [](int64_t t, const TimedSample<T> &sample) {
+                                 return t < sample.timecode;
+                               });
+  if (first != last) {
+    result.assign(first, last);
+    return result;
+  }
+  // nothing inside the window, give the nearest sample if it is at most a
+  // window away so a sensor that has stopped is not attached to every frame
+  const TimedSample<T> *nearest;
+  if (first == samples.end()) {
+    nearest = &samples.back();
+  } else if (first == samples.begin()) {
+    nearest = &*first;
+  } else {
+    auto before = std::prev(first);
+    bool beforeIsCloser = start - before->timecode <= first->timecode - end;
+    nearest = beforeIsCloser ? &*before : &*first;
+  }
+  int64_t distance = nearest->timecode < start ? start - nearest->timecode
+                                               : nearest->timecode - end;
+  if (distance <= end - start) {
+    result.push_back(*nearest);
+  }
+  return result;
+}
+
+template <typename T> T lerp(const T &a, const T &b, float t) {
+  return T{a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t,
+           a.z + (b.z - a.z) * t};
+}
+
+template <typename T>
+std::optional<T> interpolate(const std::deque<TimedSample<T>> &samples,
+                             int64_t timecode, int64_t maxDistance) {
+  if (samples.empty()) {
+    return std::nullopt;
+  }
+  auto next = std::lower_bound(samples.begin(), samples.end(), timecode,
+                               [](const TimedSample<T> &sample, int64_t t) {
+                                 return sample.timecode < t;
+                               });
+  if (next == samples.end()) {
+    if (timecode - samples.back().timecode > maxDistance) {
+      return std::nullopt;
+    }
+    return samples.back().value;
+  }
+  if (next->timecode == timecode) {
+    return next->value;
+  }
+  if (next == samples.begin()) {
+    if (next->timecode - timecode > maxDistance) {
+      return std::nullopt;
+    }
+    return next->value;
+  }
+  auto prev = std::prev(next);
+  // across a gap in the samples only a side that is close enough is used,
+  // a dropout is not filled with values made up from samples far away
+  bool prevTooFar = timecode - prev->timecode > maxDistance;
+  bool nextTooFar = next->timecode - timecode > maxDistance;
+  if (prevTooFar && nextTooFar) {
+    return std::nullopt;
+  }
+  if (prevTooFar) {
+    return next->value;
+  }
+  if (nextTooFar) {
+    return prev->value;
+  }
+  float t = static_cast<float>(timecode - prev->timecode) /
+            static_cast<float>(next->timecode - prev->timecode);
+  return lerp(prev->value, next->value, t);
+}
+} // namespace
+
+MetadataTimeBuffer::MetadataTimeBuffer(std::chrono::milliseconds history)
+    : history_(history.count() * kTicksPerMs) {}
+
+void MetadataTimeBuffer::push(int64_t timecode,
+                              const MetadataContainer &container) {
+  if (!container.accelerometerData.has_value() &&
+      !container.gyroscopeData.has_value()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (container.accelerometerData.has_value()) {
+    insertSorted(accelerometer_, timecode, container.accelerometerData.value(),
+                 history_);
+  }
+  if (container.gyroscopeData.has_value()) {
+    insertSorted(gyroscope_, timecode, container.gyroscopeData.value(),
+                 history_);
+  }
+}
+
+SensorSamples MetadataTimeBuffer::window(int64_t startTimecode,
+                                         int64_t endTimecode) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SensorSamples samples;
+  samples.accelerometer =
+      samplesBetween(accelerometer_, startTimecode, endTimecode);
+  samples.gyroscope = samplesBetween(gyroscope_, startTimecode, endTimecode);
+  return samples;
+}
+
+std::optional<AccelerometerData>
+MetadataTimeBuffer::accelerometerAt(int64_t timecode,
+                                    int64_t maxDistance) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return interpolate(accelerometer_, timecode, maxDistance);
+}
+
+std::optional<GyroscopeData>
+MetadataTimeBuffer::gyroscopeAt(int64_t timecode,
+                                int64_t maxDistance) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return interpolate(gyroscope_, timecode, maxDistance);
+}
+
+bool MetadataTimeBuffer::empty() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return accelerometer_.empty() && gyroscope_.empty();
+}
+
+void MetadataTimeBuffer::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  accelerometer_.clear();
+  gyroscope_.clear();
+}
@@ -0,0 +1,155 @@
+#include "MetricsHttpServer.hpp"
+#include "NDIWLog.hpp"
+#include "OpenMetrics.hpp"
+
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using SocketLength = int;
+namespace {
+const uintptr_t kInvalidSocket = INVALID_SOCKET;
+void closeSocket(uintptr_t s) { closesocket(static_cast<SOCKET>(s)); }
+} // namespace
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using SocketLength = socklen_t;
+namespace {
+const int kInvalidSocket = -1;
+void closeSocket(int s) { close(s); }
+} // namespace
+#endif
+
+namespace {
+// how often the accept loop checks if it should stop
+constexpr int kPollTimeoutMs = 200;
+
+// a scraper that hangs up early must not raise SIGPIPE, which would end the
+// process the server runs in, macos has no flag and uses SO_NOSIGPIPE instead
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+bool waitReadable(decltype(kInvalidSocket) s, int timeoutMs) {
+#ifdef _WIN32
+  WSAPOLLFD fd = {static_cast<SOCKET>(s), POLLRDNORM, 0};
+  return WSAPoll(&fd, 1, timeoutMs) > 0;
+#else
+  pollfd fd = {s, POLLIN, 0};
+  return poll(&fd, 1, timeoutMs) > 0;
+#endif
+}
+
+void sendAll(decltype(kInvalidSocket) s, const std::string &data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    auto result =
+        send(s, data.data() + sent, static_cast<int>(data.size() - sent),
+             kSendFlags);
+    if (result <= 0) {
+      return;
+    }
+    sent += static_cast<size_t>(result);
+  }
+}
+} // namespace
+
+MetricsHttpServer::MetricsHttpServer(uint16_t port)
+    : port_(port), running_(false), socket_(kInvalidSocket) {}
+
+MetricsHttpServer::~MetricsHttpServer() { stop(); }
+
+bool MetricsHttpServer::start() {
+  if (running_.load()) {
+    NDIW_LOG_WARN("metrics server already running");
+    return true;
+  }
+#ifdef _WIN32
+  WSADATA wsaData;
+  if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+    NDIW_LOG_ERROR("could not initialize winsock for the metrics server");
+    return false;
+  }
+#endif
+  auto s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (s == kInvalidSocket) {
+    NDIW_LOG_ERROR("could not create the metrics server socket");
+    return false;
+  }
+  int reuse = 1;
+  setsockopt(s, SOL_SOCKET, SO_REUSEADDR,
+             reinterpret_cast<const char *>(&reuse), sizeof(reuse));
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port_);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(s, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+      listen(s, 8) != 0) {
+    NDIW_LOG_ERROR("could not listen for metrics on port", port_);
+    closeSocket(s);
+    return false;
+  }
+  SocketLength length = sizeof(address);
+  if (getsockname(s, reinterpret_cast<sockaddr *>(&address), &length) == 0) {
+    port_ = ntohs(address.sin_port);
+  }
+
+  socket_ = s;
+  running_ = true;
+  thread_ = std::thread(&MetricsHttpServer::serve, this);
+  NDIW_LOG_INFO("serving metrics on 127.0.0.1 port", port_);
+  return true;
+}
+
+void MetricsHttpServer::stop() {
+  running_ = false;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (socket_ != kInvalidSocket) {
+    closeSocket(socket_);
+    socket_ = kInvalidSocket;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+  }
+}
+
+void MetricsHttpServer::serve() {
+  while (running_.load()) {
+    if (!waitReadable(socket_, kPollTimeoutMs)) {
+      continue;
+    }
+    auto client = accept(socket_, nullptr, nullptr);
+    if (client == kInvalidSocket) {
+      continue;
+    }
+#ifdef SO_NOSIGPIPE
+    int noSigPipe = 1;
+    setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe,
+               sizeof(noSigPipe));
+#endif
+    // the request is read only to be polite to the client, every path gets
+    // the metrics
+    char request[1024];
+    if (waitReadable(client, kPollTimeoutMs)) {
+      recv(client, request, sizeof(request), 0);
+    }
+    std::string body = OpenMetrics::render();
+    std::string response = "HTTP/1.1 200 OK\r\nContent-Type: ";
+    response += OpenMetrics::kContentType;
+    response += "\r\nContent-Length: " + std::to_string(body.size()) +
+                "\r\nConnection: close\r\n\r\n" + body;
+    sendAll(client, response);
+    closeSocket(client);
+  }
+}
@@ -0,0 +1,216 @@
+#include "NDICompositor.hpp"
+#include "NDIWLog.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+
+namespace {
+constexpr int kBytesPerPixel = 4;
+
+void fillPixels(uint8_t *dst, int pixels, const std::array<uint8_t, 4> &color) {
+  uint32_t pixel;
+  std::memcpy(&pixel, color.data(), sizeof(pixel));
+  if (pixel == 0) {
+    std::memset(dst, 0, size_t(pixels) * kBytesPerPixel);
+    return;
+  }
+  for (int i = 0; i < pixels; i++) {
+    std::memcpy(dst + i * kBytesPerPixel, &pixel, sizeof(pixel));
+  }
+}
+} // namespace
+
+NDICompositor::NDICompositor(std::shared_ptr<NDISender> sender,
+                             const Options &options)
+    : sender_(std::move(sender)), options_(options) {
+  if (!sender_) {
+    throw std::runtime_error("The compositor needs a sender");
+  }
+  if (options_.width <= 0 || options_.height <= 0 ||
+      options_.frameRateN <= 0 || options_.frameRateD <= 0) {
+    throw std::runtime_error("Invalid compositor output size or rate");
+  }
+  threadCount_ = options_.threads > 0
+                     ? options_.threads
+                     : std::max(1u, std::thread::hardware_concurrency());
+  pool_ = std::make_unique<ThreadPool>(threadCount_);
+  size_t pixels = size_t(options_.width) * options_.height;
+  for (auto &buffer : buffers_) {
+    buffer.resize(pixels * kBytesPerPixel);
+    fillPixels(buffer.data(), static_cast<int>(pixels), options_.background);
+  }
+}
+
+NDICompositor::~NDICompositor() {
+  stop();
+  // the last async frame points to buffers_
+  sender_->flushAsync();
+}
+
+std::vector<CompositorTile> NDICompositor::grid(int columns, int rows,
+                                                int width, int height,
+                                                int gap) {
+  std::vector<CompositorTile> tiles;
+  if (columns <= 0 || rows <= 0) {
+    return tiles;
+  }
+  int tileWidth = (width - gap * (columns - 1)) / columns;
+  int tileHeight = (height - gap * (rows - 1)) / rows;
+  for (int row = 0; row < rows; row++) {
+    for (int column = 0; column < columns; column++) {
+      tiles.push_back({column * (tileWidth + gap), row * (tileHeight + gap),
+                       tileWidth, tileHeight});
+    }
+  }
+  return tiles;
+}
+
+bool NDICompositor::addSource(NDIReceiver &receiver,
+                              const CompositorTile &tile) {
+  if (tile.width <= 0 || tile.height <= 0 || tile.x >= options_.width ||
+      tile.y >= options_.height || tile.x + tile.width <= 0 ||
+      tile.y + tile.height <= 0) {
+    NDIW_LOG_WARN("Tile", tile.x, tile.y, tile.width, tile.height,
+                  "is outside of the output");
+    return false;
+  }
+  auto source = std::make_shared<Source>();
+  source->tile = tile;
+  {
+    std::lock_guard<std::mutex> lock(sourcesMutex_);
+    sources_.push_back(source);
+  }
+  // the callback holds the source, so a receiver that outlives the compositor
+  // only keeps updating a frame nobody reads
+  FrameSubscription subscription;
+  subscription.maxFps = double(options_.frameRateN) / options_.frameRateD;
+  subscription.latestOnly = true;
+  receiver.addScaledFrameCallback(
+      tile.width, tile.height,
+      [source](Image image) {
+        auto frame = std::make_shared<const Image>(std::move(image));
+        std::lock_guard<std::mutex> lock(source->mutex);
+        source->latest = std::move(frame);
+      },
+      options_.filter, subscription);
+  return true;
+}
+
+void NDICompositor::start() {
+  if (running_.exchange(true)) {
+    NDIW_LOG_WARN("compositor already running");
+    return;
+  }
+  thread_ = std::thread(&NDICompositor::run, this);
+}
+
+void NDICompositor::stop() {
+  running_ = false;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void NDICompositor::composeRows(
+    uint8_t *output, const std::vector<std::shared_ptr<const Image>> &frames,
+    int rowBegin, int rowEnd) const {
+  size_t outputStride = size_t(options_.width) * kBytesPerPixel;
+  for (size_t i = 0; i < sources_.size(); i++) {
+    const CompositorTile &tile = sources_[i]->tile;
+    int x0 = std::max(tile.x, 0);
+    int x1 = std::min(tile.x + tile.width, options_.width);
+    int y0 = std::max({tile.y, rowBegin, 0});
+    int y1 = std::min({tile.y + tile.height, rowEnd, options_.height});
+    const Image *frame = frames[i].get();
+    for (int y = y0; y < y1; y++) {
+      uint8_t *dst = output + y * outputStride + size_t(x0) * kBytesPerPixel;
+      int sy = y - tile.y;
+      int sx = x0 - tile.x;
+      // the receiver scales to the tile size, a smaller frame is padded
+      int copied = 0;
+      if (frame && sy < frame->height && sx < frame->width) {
+        copied = std::min(x1, tile.x + frame->width) - x0;
+        std::memcpy(dst,
+                    frame->data.data() + size_t(sy) * frame->stride +
+                        size_t(sx) * kBytesPerPixel,
+                    size_t(copied) * kBytesPerPixel);
+      }
+      fillPixels(dst + size_t(copied) * kBytesPerPixel, x1 - x0 - copied,
+                 options_.background);
+    }
+  }
+}
+
+void NDICompositor::run() {
+  using Clock = std::chrono::steady_clock;
+  const auto framePeriod = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(double(options_.frameRateD) /
+                                    options_.frameRateN));
+  // a band per thread, a few more so an uneven layout still spreads
+  const int bands = static_cast<int>(
+      std::min<size_t>(threadCount_ * 2, size_t(options_.height)));
+  std::vector<std::shared_ptr<const Image>> frames;
+  std::vector<std::future<void>> pending;
+  pending.reserve(bands);
+
+  NDIlib_video_frame_v2_t video;
+  video.xres = options_.width;
+  video.yres = options_.height;
+  video.FourCC = NDIlib_FourCC_video_type_RGBA;
+  video.frame_rate_N = options_.frameRateN;
+  video.frame_rate_D = options_.frameRateD;
+  video.line_stride_in_bytes = options_.width * kBytesPerPixel;
+
+  auto clockStart = Clock::now();
+  int64_t frameIndex = 0;
+  while (running_) {
+    auto composeStart = Clock::now();
+    {
+      NDIW_TRACE_SCOPE("compose");
+      // the sources are only added to, holding the lock over the copy keeps
+      // sources_ and frames the same length
+      std::lock_guard<std::mutex> lock(sourcesMutex_);
+      frames.resize(sources_.size());
+      for (size_t i = 0; i < sources_.size(); i++) {
+        std::lock_guard<std::mutex> sourceLock(sources_[i]->mutex);
+        frames[i] = sources_[i]->latest;
+      }
+      uint8_t *output = buffers_[currentBuffer_].data();
+      for (int band = 0; band < bands; band++) {
+        int rowBegin = options_.height * band / bands;
+        int rowEnd = options_.height * (band + 1) / bands;
+        pending.push_back(pool_->submit([=, &frames]() {
+          composeRows(output, frames, rowBegin, rowEnd);
+        }));
+      }
+      for (auto &future : pending) {
+        future.get();
+      }
+      pending.clear();
+    }
+    composeTime_.record(Clock::now() - composeStart);
+
+    // the sdk lets go of the other buffer when this one is sent
+    video.p_data = buffers_[currentBuffer_].data();
+    sender_->feedVideoFrame(video, true);
+    currentBuffer_ = (currentBuffer_ + 1) % buffers_.size();
+    framesSent_.fetch_add(1, std::memory_order_relaxed);
+
+    frameIndex++;
+    auto due = clockStart + framePeriod * frameIndex;
+    auto now = Clock::now();
+    if (now - due > framePeriod) {
+      // fell behind by more than a frame, start the clock again instead of
+      // bursting frames to catch up
+      NDIW_LOG_WARN_EVERY(5000, "Compositor is behind the frame rate");
+      clockStart = now;
+      frameIndex = 0;
+    } else {
+      std::this_thread::sleep_until(due);
+    }
+  }
+}
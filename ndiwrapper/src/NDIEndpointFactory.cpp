@@ -0,0 +1,81 @@
+#include "NDIEndpointFactory.hpp"
+#include "NDIWLog.hpp"
+#include "NDILibraryManager.hpp"
+
+#include <stdexcept>
+#include <thread>
+
+namespace {
+size_t creationThreadCount(size_t requested) {
+  if (requested > 0) {
+    return requested;
+  }
+  size_t hardware = std::thread::hardware_concurrency();
+  return hardware > 0 ? hardware : 4;
+}
+} // namespace
+
+NDIEndpointFactory::NDIEndpointFactory(size_t creationThreads,
+                                       size_t callbackThreads)
+    : lib_(NDILibraryManager::Acquire()),
+      callbackPool_(std::make_shared<ThreadPool>(callbackThreads)),
+      creationPool_(
+          std::make_unique<ThreadPool>(creationThreadCount(creationThreads))) {
+  if (!lib_) {
+    throw std::runtime_error("Failed to load the NDI library");
+  }
+}
+
+NDIEndpointFactory::~NDIEndpointFactory() {
+  // runs the pending creations before the runtime is released so they do not
+  // load it again, the endpoints hold their own reference to it
+  creationPool_.reset();
+  {
+    std::lock_guard<std::mutex> lock(discoveryMutex_);
+    discoveries_.clear();
+  }
+  NDILibraryManager::Release();
+}
+
+void NDIEndpointFactory::warmDiscovery(const std::string &group,
+                                       bool findGroup) {
+  auto discovery = NDISourceDiscovery::acquire(group, findGroup);
+  if (!discovery) {
+    NDIW_LOG_ERROR("could not start source discovery for group", group);
+    return;
+  }
+  std::lock_guard<std::mutex> lock(discoveryMutex_);
+  discoveries_.push_back(std::move(discovery));
+}
+
+std::future<std::unique_ptr<NDISender>>
+NDIEndpointFactory::createSender(const std::string &name,
+                                 const std::string &group, bool enableVideo,
+                                 bool enableAudio) {
+  return creationPool_->submit([=, pool = callbackPool_]() {
+    return std::make_unique<NDISender>(name, group, enableVideo, enableAudio,
+                                       pool);
+  });
+}
+
+std::future<std::unique_ptr<NDIReceiver>>
+NDIEndpointFactory::createReceiver(const std::string &group, bool findGroup,
+                                   bool synced,
+                                   NDIlib_recv_bandwidth_e bandwidth) {
+  return creationPool_->submit([=, pool = callbackPool_]() {
+    return std::make_unique<NDIReceiver>(group, findGroup, synced, bandwidth,
+                                         pool);
+  });
+}
+
+std::vector<std::future<std::unique_ptr<NDISender>>>
+NDIEndpointFactory::createSenders(const std::vector<std::string> &names,
+                                  const std::string &group, bool enableVideo,
+                                  bool enableAudio) {
+  std::vector<std::future<std::unique_ptr<NDISender>>> senders;
+  senders.reserve(names.size());
+  for (const auto &name : names) {
+    senders.push_back(createSender(name, group, enableVideo, enableAudio));
+  }
+  return senders;
+}
@@ -1,12 +1,282 @@
 #include "NDILibraryManager.hpp"
+#include "NDIWLog.hpp"
+
+#include <condition_variable>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
 
 // In .cpp file - initialize statics
 // Static member definitions (put these in your .cpp file)
 std::mutex NDILibraryManager::mutex_;
-int NDILibraryManager::refCount_ = 0;
-const NDIlib_v6 *NDILibraryManager::lib_ = nullptr;
+std::atomic<int> NDILibraryManager::refCount_{0};
+std::atomic<const NDIlib_v6 *> NDILibraryManager::lib_{nullptr};
+std::atomic<NDILibraryManager::Residency> NDILibraryManager::residency_{
+    NDILibraryManager::Residency::Release};
+std::atomic<int64_t> NDILibraryManager::lingerMs_{5000};
+NDILibraryManager::Stats NDILibraryManager::stats_;
 #ifdef _WIN32
 HMODULE NDILibraryManager::hNDI_ = nullptr;
 #else
 void *NDILibraryManager::hNDI_ = nullptr;
 #endif
+
+namespace {
+/**
+ * @brief the thread that unloads the runtime after the linger time, joined
+ * when the process exits
+ */
+struct LingerThread {
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::chrono::steady_clock::time_point deadline;
+  bool pending = false;
+  bool stopping = false;
+  std::thread thread;
+
+  ~LingerThread() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    cv.notify_all();
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+};
+LingerThread lingerThread;
+
+using Clock = std::chrono::steady_clock;
+std::chrono::microseconds elapsedSince(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                               start);
+}
+} // namespace
+
+void NDILibraryManager::SetResidency(Residency residency,
+                                     std::chrono::milliseconds linger) {
+  lingerMs_ = linger.count();
+  residency_ = residency;
+  if (residency == Residency::Release && refCount_.load() == 0) {
+    // drop a runtime that was kept loaded by the previous residency
+    std::lock_guard<std::mutex> lock(mutex_);
+    UnloadIfUnused();
+  }
+}
+
+NDILibraryManager::Stats NDILibraryManager::GetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+const NDIlib_v6 *NDILibraryManager::AcquireSlow() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const NDIlib_v6 *lib = lib_.load();
+  if (!lib) {
+    lib = Load();
+    if (!lib) {
+      refCount_--;
+      return nullptr;
+    }
+    lib_ = lib;
+  }
+  return lib;
+}
+
+void NDILibraryManager::OnLastRelease() {
+  switch (residency_.load()) {
+  case Residency::Release: {
+    std::lock_guard<std::mutex> lock(mutex_);
+    UnloadIfUnused();
+    break;
+  }
+  case Residency::Linger: {
+    std::lock_guard<std::mutex> lock(lingerThread.mutex);
+    lingerThread.deadline =
+        Clock::now() + std::chrono::milliseconds(lingerMs_.load());
+    lingerThread.pending = true;
+    if (!lingerThread.thread.joinable()) {
+      lingerThread.thread = std::thread(&NDILibraryManager::LingerLoop);
+    }
+    lingerThread.cv.notify_all();
+    break;
+  }
+  case Residency::Process:
+    break;
+  }
+}
+
+void NDILibraryManager::LingerLoop() {
+  std::unique_lock<std::mutex> lock(lingerThread.mutex);
+  while (!lingerThread.stopping) {
+    if (!lingerThread.pending) {
+      lingerThread.cv.wait(lock);
+      continue;
+    }
+    // a new release moves the deadline, so wait until it stops moving
+    if (lingerThread.cv.wait_until(lock, lingerThread.deadline) ==
+        std::cv_status::no_timeout) {
+      continue;
+    }
+    if (Clock::now() < lingerThread.deadline) {
+      continue;
+    }
+    lingerThread.pending = false;
+    lock.unlock();
+    {
+      std::lock_guard<std::mutex> libLock(mutex_);
+      UnloadIfUnused();
+    }
+    lock.lock();
+  }
+}
+
+void NDILibraryManager::UnloadIfUnused() {
+  const NDIlib_v6 *lib = lib_.load();
+  if (!lib) {
+    return;
+  }
+  // hide the runtime first, an Acquire that got in before this sees the
+  // count and we back off, one that comes after goes to the slow path and
+  // waits for the mutex
+  lib_ = nullptr;
+  if (refCount_.load() != 0) {
+    lib_ = lib;
+    return;
+  }
+
+  NDIW_LOG_INFO("Releasing NDI library...");
+  lib->destroy();
+#ifdef _WIN32
+  if (hNDI_) {
+    FreeLibrary(hNDI_);
+    hNDI_ = nullptr;
+  }
+#else
+  if (hNDI_) {
+    dlclose(hNDI_);
+    hNDI_ = nullptr;
+  }
+#endif
+  stats_.unloads++;
+  NDIW_LOG_INFO("NDI library released");
+}
+
+const NDIlib_v6 *NDILibraryManager::Load() {
+  auto loadStart = Clock::now();
+#ifdef _WIN32
+  NDIW_LOG_INFO("Loading NDI library (Windows)...");
+
+  std::vector<std::string> searchPaths;
+
+  // 0. Explicit override, eg. a stand-in runtime
+  char overridePath[MAX_PATH] = {0};
+  size_t overrideLen = 0;
+  if (getenv_s(&overrideLen, overridePath, sizeof(overridePath),
+               "NDIWRAPPER_NDI_LIBRARY") == 0 &&
+      overrideLen > 0) {
+    searchPaths.push_back(overridePath);
+  }
+
+  // 1. Same folder as our plugin DLL
+  std::string pluginDir = GetPluginDirectory();
+  if (!pluginDir.empty()) {
+    searchPaths.push_back(pluginDir + "\\Processing.NDI.Lib.x64.dll");
+  }
+
+  // 2. NDI Runtime environment variable (if user has NDI Tools installed)
+  char ndiRuntimePath[MAX_PATH] = {0};
+  size_t len = 0;
+  if (getenv_s(&len, ndiRuntimePath, sizeof(ndiRuntimePath),
+               "NDI_RUNTIME_DIR_V6") == 0 &&
+      len > 0) {
+    searchPaths.push_back(std::string(ndiRuntimePath) +
+                          "\\Processing.NDI.Lib.x64.dll");
+  }
+
+  // 3. Fallback to just the DLL name (relies on system PATH)
+  searchPaths.push_back("Processing.NDI.Lib.x64.dll");
+
+  // Try each path
+  for (const auto &path : searchPaths) {
+    NDIW_LOG_DEBUG("Trying to load NDI from:", path);
+    hNDI_ = LoadLibraryA(path.c_str());
+    if (hNDI_ != NULL) {
+      NDIW_LOG_INFO("Successfully loaded NDI from:", path);
+      break;
+    } else {
+      DWORD error = GetLastError();
+      NDIW_LOG_DEBUG("Failed to load from", path, "- error:", error);
+    }
+  }
+
+  if (hNDI_ == NULL) {
+    DWORD error = GetLastError();
+    NDIW_LOG_ERROR("Could not load Processing.NDI.Lib.x64.dll from any "
+                      "location, last error:",
+                      error);
+    return nullptr;
+  }
+
+  auto load_fn =
+      (const NDIlib_v6 *(*)(void))GetProcAddress(hNDI_, "NDIlib_v6_load");
+#else
+  NDIW_LOG_INFO("Loading NDI library (Linux)...");
+
+  std::vector<std::string> searchPaths;
+  // 1. Explicit override, eg. a stand-in runtime
+  if (const char *overridePath = std::getenv("NDIWRAPPER_NDI_LIBRARY")) {
+    searchPaths.push_back(overridePath);
+  }
+  // 2. NDI Runtime environment variable
+  if (const char *runtimeDir = std::getenv("NDI_RUNTIME_DIR_V6")) {
+    searchPaths.push_back(std::string(runtimeDir) + "/libndi.so");
+  }
+  // 3. Just the name, relies on the library path
+  searchPaths.push_back("libndi.so");
+
+  for (const auto &path : searchPaths) {
+    NDIW_LOG_DEBUG("Trying to load NDI from:", path);
+    hNDI_ = dlopen(path.c_str(), RTLD_NOW);
+    if (hNDI_ != nullptr) {
+      NDIW_LOG_INFO("Successfully loaded NDI from:", path);
+      break;
+    }
+    NDIW_LOG_DEBUG("Failed to load from", path, "-", dlerror());
+  }
+  if (hNDI_ == nullptr) {
+    NDIW_LOG_ERROR("Could not load libndi.so from any location");
+    return nullptr;
+  }
+  auto load_fn = (const NDIlib_v6 *(*)(void))dlsym(hNDI_, "NDIlib_v6_load");
+#endif
+
+  if (!load_fn) {
+    NDIW_LOG_ERROR("NDIlib_v6_load function not found");
+#ifdef _WIN32
+    FreeLibrary(hNDI_);
+#else
+    dlclose(hNDI_);
+#endif
+    hNDI_ = nullptr;
+    return nullptr;
+  }
+
+  const NDIlib_v6 *lib = load_fn();
+  if (!lib) {
+    NDIW_LOG_ERROR("NDIlib_v6_load returned nullptr");
+    return nullptr;
+  }
+  stats_.loadTime = elapsedSince(loadStart);
+
+  auto initializeStart = Clock::now();
+  lib->initialize();
+  stats_.initializeTime = elapsedSince(initializeStart);
+  stats_.loads++;
+  NDIW_LOG_INFO("NDI initialized successfully, load took",
+                   stats_.loadTime.count(), "us, initialize took",
+                   stats_.initializeTime.count(), "us");
+  return lib;
+}
@@ -1,29 +1,63 @@
 #include "NDIReceiver.hpp"
-#include "Logger.hpp"
+#include "NDIWLog.hpp"
+
+#include "FrameConversion.hpp"
+#include "StatsRegistry.hpp"
+#include "Trace.hpp"
 
 #include <iostream>
+
+namespace {
+bool carriesVideo(NDIlib_recv_bandwidth_e bandwidth) {
+  return bandwidth != NDIlib_recv_bandwidth_audio_only &&
+         bandwidth != NDIlib_recv_bandwidth_metadata_only;
+}
+
+// how long a warm switch waits for the receiver at the right bandwidth to
+// deliver before swapping it in anyway
+constexpr auto kBandwidthRestoreTimeout = std::chrono::seconds(2);
+} // namespace
+
 NDIReceiver::NDIReceiver(const std::string &groupToFind, bool findGroup,
-                         bool synced)
+                         bool synced, NDIlib_recv_bandwidth_e bandwidth,
+                         std::shared_ptr<ThreadPool> callbackPool)
     : NDIBase(
-          [this](NDIlib_metadata_frame_t &metadataFrame) {
-            return lib->NDIlib_recv_capture_v2(pNDIInstance_, nullptr, nullptr,
-                                               &metadataFrame, 0);
+          // metadata is captured on its own thread, the frame capture passes
+          // nullptr for metadata so the two never compete for the same frames
+          [this](NDIlib_recv_instance_t instance,
+                 NDIlib_metadata_frame_t &metadataFrame, uint32_t timeoutMs) {
+            return lib->NDIlib_recv_capture_v2(instance, nullptr, nullptr,
+                                               &metadataFrame, timeoutMs);
+          },
+          [this](NDIlib_recv_instance_t instance,
+                 NDIlib_metadata_frame_t &metadataFrame) {
+            lib->NDIlib_recv_send_metadata(instance, &metadataFrame);
           },
-          [this](NDIlib_metadata_frame_t &metadataFrame) {
-            lib->NDIlib_recv_send_metadata(pNDIInstance_, &metadataFrame);
+          [this](NDIlib_recv_instance_t instance,
+                 NDIlib_metadata_frame_t &metadataFrame) {
+            lib->NDIlib_recv_free_metadata(instance, &metadataFrame);
           },
-          [this](NDIlib_metadata_frame_t &metadataFrame) {
-            lib->NDIlib_recv_free_metadata(pNDIInstance_, &metadataFrame);
-          }),
+          std::move(callbackPool)),
       isReceivingRunning_(false), isSourceFindingRunning_(false),
-      isSourceSet_(false), _findGroup(findGroup), currentOutput_(),
-      groupToFind_(groupToFind), _pndiFrameSync(nullptr), m_synced(synced),
-      dontTryToSetSource_(false) {
-  // Initialization code, if any
-  currentOutput_.p_ndi_name = "";
+      isSourceSet_(false), audioFormat_(std::make_shared<const AudioFormat>()),
+      _findGroup(findGroup), groupToFind_(groupToFind), m_synced(synced),
+      dontTryToSetSource_(false),
+      bandwidth_(bandwidth), currentBandwidth_(bandwidth),
+      standbyBandwidth_(NDIlib_recv_bandwidth_highest),
+      lastSwitchLatencyUs_(0) {
+  statsId_ = StatsRegistry::add(
+      "receiver",
+      [this]() {
+        std::lock_guard<std::mutex> lock(sourceMutex_);
+        return currentOutputString_;
+      },
+      [this]() { return getStats(); });
 }
 
-NDIReceiver::~NDIReceiver() { stop(); }
+NDIReceiver::~NDIReceiver() {
+  StatsRegistry::remove(statsId_);
+  stop();
+}
 
 Image NDIReceiver::getFrame() {
   std::lock_guard<std::mutex> lock(frameMutex_);
@@ -48,14 +82,84 @@ Audio NDIReceiver::getAudioNew() {
   audioAvailable_ = false; // Reset the flag
   return audio;
 }
-void NDIReceiver::addFrameCallback(FrameCallback frameCallback) {
+void NDIReceiver::addFrameCallback(FrameCallback frameCallback,
+                                   const FrameSubscription &subscription) {
   std::lock_guard<std::mutex> lock(frameCallbackVecMutex_);
-  _frameCallbacks.push_back(frameCallback);
+  _frameCallbacks.emplace_back(std::move(frameCallback), subscription);
 }
 void NDIReceiver::addFrameWithMetadataCallback(
-    FrameWithMetadataCallback frameCallback) {
-  std::lock_guard<std::mutex> lock(frameCallbackVecMutex_);
-  _frameWithMetadataCallbacks.push_back(frameCallback);
+    FrameWithMetadataCallback frameCallback,
+    const FrameSubscription &subscription) {
+  std::lock_guard<std::mutex> lock(frameCallbackVecMutexMetadata_);
+  _frameWithMetadataCallbacks.emplace_back(std::move(frameCallback),
+                                           subscription);
+}
+
+void NDIReceiver::addScaledFrameCallback(
+    int width, int height, FrameCallback frameCallback,
+    ImageScaling::Filter filter, const FrameSubscription &subscription) {
+  std::lock_guard<std::mutex> lock(scaledCallbackMutex_);
+  for (auto &output : scaledOutputs_) {
+    if (output.scaler.width() == width && output.scaler.height() == height &&
+        output.scaler.filter() == filter) {
+      output.callbacks.emplace_back(std::move(frameCallback), subscription);
+      return;
+    }
+  }
+  ScaledOutput output{ImageScaling::Scaler(width, height, filter), {}};
+  output.callbacks.emplace_back(std::move(frameCallback), subscription);
+  scaledOutputs_.push_back(std::move(output));
+}
+
+void NDIReceiver::setFullFrameCopy(bool enabled) { fullFrameCopy_ = enabled; }
+
+bool NDIReceiver::selectFullFrameSubscribers(
+    std::chrono::steady_clock::time_point now) {
+  bool selected = fullFrameCopy_.load();
+  {
+    std::lock_guard<std::mutex> lock(frameCallbackVecMutex_);
+    for (auto &subscriber : _frameCallbacks) {
+      selected |= subscriber.select(now);
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(frameCallbackVecMutexMetadata_);
+    for (auto &subscriber : _frameWithMetadataCallbacks) {
+      selected |= subscriber.select(now);
+    }
+  }
+  return selected;
+}
+
+void NDIReceiver::dispatchScaledFrames(const NDIlib_video_frame_v2_t &frame) {
+  std::lock_guard<std::mutex> lock(scaledCallbackMutex_);
+  if (scaledOutputs_.empty()) {
+    return;
+  }
+  auto stats = stats_;
+  auto now = std::chrono::steady_clock::now();
+  for (auto &output : scaledOutputs_) {
+    bool selected = false;
+    for (auto &subscriber : output.callbacks) {
+      selected |= subscriber.select(now);
+    }
+    if (!selected) {
+      continue;
+    }
+    auto scaled = std::make_shared<Image>();
+    {
+      NDIW_TRACE_SCOPE("scale video");
+      auto scaleStart = std::chrono::steady_clock::now();
+      output.scaler.scale(frame.p_data, frame.xres, frame.yres,
+                          frame.line_stride_in_bytes, *scaled);
+      scaled->timestamp = frame.timestamp * 100;
+      stats->scaleTime.record(std::chrono::steady_clock::now() - scaleStart);
+    }
+    std::shared_ptr<const Image> shared = std::move(scaled);
+    for (auto &subscriber : output.callbacks) {
+      subscriber.dispatch(*threadPool_, shared, stats, now);
+    }
+  }
 }
 
 void NDIReceiver::addNDISourceCallback(NDISourceCallback sourceCallback) {
@@ -63,11 +167,32 @@ void NDIReceiver::addNDISourceCallback(NDISourceCallback sourceCallback) {
   _ndiSourceCallbacks.push_back(sourceCallback);
 }
 
+void NDIReceiver::addNDISourceEventCallback(
+    NDISourceEventCallback sourceEventCallback) {
+  std::lock_guard<std::mutex> lock(ndiSourceCallbackMutex_);
+  _ndiSourceEventCallbacks.push_back(sourceEventCallback);
+}
+
 void NDIReceiver::addAudioCallback(AudioCallback audioCallback) {
   std::lock_guard<std::mutex> lock(audioCallbackVecMutex_);
   _audioCallbacks.push_back(audioCallback);
 }
 
+void NDIReceiver::addAudio16Callback(Audio16Callback audioCallback) {
+  std::lock_guard<std::mutex> lock(audioCallbackVecMutex_);
+  _audio16Callbacks.push_back(audioCallback);
+}
+
+void NDIReceiver::addAudio24Callback(Audio24Callback audioCallback) {
+  std::lock_guard<std::mutex> lock(audioCallbackVecMutex_);
+  _audio24Callbacks.push_back(audioCallback);
+}
+
+void NDIReceiver::setAudioFormat(const AudioFormat &format) {
+  std::atomic_store(&audioFormat_,
+                    std::make_shared<const AudioFormat>(format));
+}
+
 void NDIReceiver::setFindOnlyGroupsState(bool state) {
   if (state != _findGroup.load()) {
 
@@ -77,18 +202,32 @@ void NDIReceiver::setFindOnlyGroupsState(bool state) {
 }
 
 void NDIReceiver::stopSourceFinding() {
-  isSourceFindingRunning_.store(false);
-  if (sourceThread_.joinable()) {
-    sourceThread_.join();
+  if (isSourceFindingRunning_.exchange(false)) {
+    auto discovery = std::atomic_load(&discovery_);
+    if (discovery) {
+      discovery->unsubscribe(sourceListenerId_);
+    }
   }
 }
 
 void NDIReceiver::startSourceFinding() {
   if (isSourceFindingRunning_.load() == false) {
+    auto discovery = std::atomic_load(&discovery_);
+    if (!discovery) {
+      discovery = NDISourceDiscovery::acquire(groupToFind_, _findGroup.load());
+      if (!discovery) {
+        NDIW_LOG_ERROR("could not start source finding");
+        return;
+      }
+      std::atomic_store(&discovery_, discovery);
+    }
     isSourceFindingRunning_ = true;
-    sourceThread_ = std::thread(&NDIReceiver::updateSources, this);
+    sourceListenerId_ = discovery->subscribe(
+        [this](const std::vector<NDISourceEvent> &events) {
+          onSourceEvents(events);
+        });
   } else {
-    Logger::log_warn("source finding is already running");
+    NDIW_LOG_WARN("source finding is already running");
   }
 }
 void NDIReceiver::stopFrameGeneration() {
@@ -100,7 +239,7 @@ void NDIReceiver::stopFrameGeneration() {
 }
 void NDIReceiver::startFrameGeneration() {
   if (isReceivingRunning_.load()) {
-    Logger::log_warn("frame generation already running");
+    NDIW_LOG_WARN("frame generation already running");
     return;
   }
   isReceivingRunning_ = true;
@@ -115,17 +254,21 @@ void NDIReceiver::start() {
 }
 
 void NDIReceiver::stop() {
-  Logger::log_info("stopping receiver");
+  NDIW_LOG_DEBUG("stopping receiver");
   stopMetadataListening();
   stopSourceFinding();
   stopFrameGeneration();
   audioAvailable_ = true;
   audioCondition_.notify_all();
-  std::lock_guard<std::mutex> lock(pndiMutex_);
-  if (pNDIInstance_) {
-    lib->NDIlib_recv_destroy(pNDIInstance_);
-    pNDIInstance_ = nullptr;
+  std::map<std::string, StandbyConnection> standby;
+  {
+    std::lock_guard<std::mutex> lock(standbyMutex_);
+    standby.swap(standby_);
   }
+  standby.clear();
+  std::lock_guard<std::mutex> lock(pndiMutex_);
+  _pndiFrameSync.reset();
+  pNDIInstance_.reset();
 }
 
 void NDIReceiver::setAudioConnectedCallback(ConnectionCallbackAudio callback) {
@@ -144,122 +287,364 @@ void NDIReceiver::setVideoDisconnectedCallback(ConnectionCallback callback) {
   _videoDisconnected = callback;
 }
 
+SensorSamples NDIReceiver::getSensorSamples(int64_t startTimecode,
+                                            int64_t endTimecode) {
+  return sensorBuffer_.window(startTimecode, endTimecode);
+}
+
+void NDIReceiver::onMetadataFrame(const NDIlib_metadata_frame_t &frame,
+                                  const MetadataContainer &container) {
+  if (auto recorder = std::atomic_load(&recorder_)) {
+    recorder->recordMetadata(frame);
+  }
+  sensorBuffer_.push(frame.timecode, container);
+}
+
+void NDIReceiver::setRecorder(std::shared_ptr<FrameRecorder> recorder) {
+  std::atomic_store(&recorder_, std::move(recorder));
+}
+
 bool NDIReceiver::setOutput(const std::string &outputName) {
   std::lock_guard<std::mutex> lock(setOutputMutex_);
-  Logger::log_info("setting output to", outputName);
+  auto switchStart = std::chrono::steady_clock::now();
+  NDIW_LOG_DEBUG("setting output to", outputName);
   try {
-    dontTryToSetSource_ = true;
-    if (outputName == std::string(currentOutput_.p_ndi_name)) {
-      Logger::log_info("output is the same as current, doing nothing");
-      dontTryToSetSource_ = false;
+    if (outputName == currentOutput_.name) {
+      NDIW_LOG_DEBUG("output is the same as current, doing nothing");
       return false;
     }
+    bandwidthRestore_ = {};
+    bandwidthRestorePending_ = false;
+    // a warm standby is already connected and receiving, switching to it is
+    // only a swap of the handles and no blank frames are needed
+    StandbyConnection connection = takeStandby(outputName);
+    bool warm = connection.instance != nullptr;
+    if (!warm) {
+      dontTryToSetSource_ = true;
+    }
     std::unique_lock<std::mutex> sourceLock(sourceMutex_);
     currentOutputString_ = outputName;
-    decltype(ndiSources_.at(outputName)) ndisource = ndiSources_.at(outputName);
+    if (!warm) {
+      connection.url = sourcesSnapshot()->at(outputName);
+    }
     isSourceSet_ = false;
-    currentOutput_ = ndisource;
+    auto previousOutput = currentOutput_;
+    currentOutput_ = {outputName, connection.url};
 
     sourceLock.unlock();
 
-    std::lock_guard<std::mutex> lock(pndiMutex_);
-    if (m_synced && _pndiFrameSync) {
-      lib->NDIlib_framesync_destroy(_pndiFrameSync);
-    }
-    if (pNDIInstance_) {
-      lib->NDIlib_recv_destroy(pNDIInstance_);
-    }
-    // Create a new receiver for the selected source
-    Logger::log_info("connecting to output");
-    NDIlib_recv_create_v3_t recv_desc;
-    recv_desc.source_to_connect_to =
-        currentOutput_; // Assuming selectedSource_ is of type NDIlib_source_t
-    recv_desc.color_format =
-        NDIlib_recv_color_format_e_RGBX_RGBA; // Example format
-    pNDIInstance_ = lib->NDIlib_recv_create_v3(&recv_desc);
-    if (m_synced) {
-      _pndiFrameSync = lib->NDIlib_framesync_create(pNDIInstance_);
-    }
-    Logger::log_info("created connection");
+    if (!warm) {
+      // Create a new receiver for the selected source
+      NDIW_LOG_DEBUG("connecting to output");
+      connection.instance = createRecvInstance(
+          currentOutput_.name, currentOutput_.url, bandwidth_);
+      connection.bandwidth = bandwidth_;
+    }
+    auto previousBandwidth = currentBandwidth_.load();
+    currentBandwidth_ = connection.bandwidth;
+    InstanceHandle instance = installInstance(std::move(connection.instance));
+    // the previous output stays connected if it is one of the standbys
+    returnToStandby(previousOutput.name, previousOutput.url,
+                    previousBandwidth, std::move(instance));
+    if (connection.bandwidth != bandwidth_) {
+      // the standby was made at the standby bandwidth, keep it until a
+      // receiver at bandwidth_ delivers, see finishBandwidthRestore
+      bandwidthRestore_ = {currentOutput_.url,
+                           createRecvInstance(currentOutput_.name,
+                                              currentOutput_.url, bandwidth_),
+                           bandwidth_};
+      bandwidthRestoreStart_ = std::chrono::steady_clock::now();
+      bandwidthRestorePending_ = bandwidthRestore_.instance != nullptr;
+    }
+    // timecodes of the previous source have nothing to do with the new one
+    sensorBuffer_.clear();
+    NDIW_LOG_DEBUG(warm ? "switched to standby connection"
+                           : "created connection");
     isSourceSet_ = true;
     dontTryToSetSource_ = false;
   } catch (const std::exception &e) {
-    Logger::log_error("could not set currentOutput_: {}", e.what());
+    // the frame thread retries every few hundred ms while the source is gone
+    NDIW_LOG_ERROR_EVERY(5000, "could not set the output", outputName,
+                         e.what());
     isSourceSet_ = false;
     dontTryToSetSource_ = false;
     return false;
   }
-  Logger::log_info("output set", outputName);
+  lastSwitchLatencyUs_ =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - switchStart)
+          .count();
+  NDIW_LOG_INFO("output set", outputName);
   return true;
 }
 
-void NDIReceiver::resetSources() {
-  stop();
-  ndiSources_.clear();
-  start();
+void NDIReceiver::setBandwidth(NDIlib_recv_bandwidth_e bandwidth) {
+  std::lock_guard<std::mutex> lock(setOutputMutex_);
+  bandwidth_ = bandwidth;
+  bandwidthRestore_ = {};
+  bandwidthRestorePending_ = false;
+  if (currentOutput_.name.empty() || currentBandwidth_ == bandwidth) {
+    return;
+  }
+  // the sdk can not change the bandwidth of a receiver so connect again, the
+  // old receiver keeps delivering until the new one is swapped in
+  NDIW_LOG_INFO("reconnecting", currentOutput_.name, "with new bandwidth");
+  auto instance =
+      createRecvInstance(currentOutput_.name, currentOutput_.url, bandwidth);
+  if (!instance) {
+    NDIW_LOG_ERROR("could not reconnect with the new bandwidth");
+    return;
+  }
+  currentBandwidth_ = bandwidth;
+  // the previous receiver is released once the capture threads let go of it
+  installInstance(std::move(instance));
 }
 
-void NDIReceiver::updateSources() {
-  try {
-    while (isSourceFindingRunning_.load()) {
-      decltype(ndiSources_) tempSources;
-      std::vector<std::string> newSources;
-      NDIlib_find_create_t NDI_find_create_desc; /* Use defaults */
-      if (_findGroup.load()) {
-        NDI_find_create_desc.p_groups = groupToFind_.c_str();
-      }
-      NDIlib_find_instance_t pNDI_find =
-          lib->NDIlib_find_create_v2(&NDI_find_create_desc);
-      if (!pNDI_find) {
-        Logger::log_error("Failed to create NDI finder instance.");
-        return;
-      }
-      for (int i = 0; i < 10 && isSourceFindingRunning_.load(); i++) {
-        // Wait up till 2 seconds to check for new sources to be added or
-        // removed
-        if (lib->NDIlib_find_wait_for_sources(pNDI_find, 2000)) {
-          // Get the updated list of sources
-          uint32_t no_sources = 0;
-          const NDIlib_source_t *p_sources =
-              lib->NDIlib_find_get_current_sources(pNDI_find, &no_sources);
-          Logger::log_info("total sources found", no_sources);
-          // Add the sources to our new list
-          for (uint32_t i = 0; i < no_sources; i++) {
-            Logger::log_info("found source", p_sources[i].p_ndi_name);
-            tempSources[p_sources[i].p_ndi_name] = p_sources[i];
-            {
-              {
-                std::lock_guard<std::mutex> lock(sourceMutex_);
-                ndiSources_[p_sources[i].p_ndi_name] = p_sources[i];
-              }
-              std::lock_guard<std::mutex> lock(ndiSourceCallbackMutex_);
-              for (const auto &callback : _ndiSourceCallbacks) {
-                std::string sourceName = std::string(p_sources[i].p_ndi_name);
-                threadPool_.enqueue([=]() { callback(sourceName); });
-              }
-            }
+void NDIReceiver::finishBandwidthRestore() {
+  // declared before the lock so the previous receiver is released after it
+  InstanceHandle previous;
+  std::lock_guard<std::mutex> lock(setOutputMutex_);
+  if (!bandwidthRestore_.instance) {
+    bandwidthRestorePending_ = false;
+    return;
+  }
+  auto instance = bandwidthRestore_.instance.get();
+  auto bandwidth = bandwidthRestore_.bandwidth;
+  bool delivering;
+  if (bandwidth == NDIlib_recv_bandwidth_metadata_only) {
+    delivering = lib->NDIlib_recv_get_no_connections(instance) > 0;
+  } else {
+    NDIlib_recv_queue_t queue;
+    lib->NDIlib_recv_get_queue(instance, &queue);
+    delivering = carriesVideo(bandwidth) ? queue.video_frames > 0
+                                         : queue.audio_frames > 0;
+  }
+  if (!delivering) {
+    if (std::chrono::steady_clock::now() - bandwidthRestoreStart_ <
+        kBandwidthRestoreTimeout) {
+      return;
+    }
+    NDIW_LOG_WARN("nothing from", currentOutput_.name,
+                  "at the new bandwidth yet, swapping it in anyway");
+  }
+  currentBandwidth_ = bandwidth;
+  previous = installInstance(std::move(bandwidthRestore_.instance));
+  bandwidthRestore_ = {};
+  bandwidthRestorePending_ = false;
+}
+
+NDIlib_recv_bandwidth_e NDIReceiver::getBandwidth() {
+  std::lock_guard<std::mutex> lock(setOutputMutex_);
+  return bandwidth_;
+}
+
+NDIReceiver::InstanceHandle
+NDIReceiver::installInstance(InstanceHandle instance) {
+  FrameSyncHandle frameSync;
+  if (m_synced && instance) {
+    // the deleter keeps the receiver alive until the framesync is destroyed
+    frameSync = FrameSyncHandle(
+        lib->NDIlib_framesync_create(instance.get()),
+        [lib = lib, instance](NDIlib_framesync_instance_t p) {
+          if (p) {
+            lib->NDIlib_framesync_destroy(p);
           }
-        }
+        });
+  }
+
+  // swap the handles under the lock, the old ones are released outside of
+  // it once the capture threads have let go of their copies
+  {
+    std::lock_guard<std::mutex> lock(pndiMutex_);
+    std::swap(pNDIInstance_, instance);
+    std::swap(_pndiFrameSync, frameSync);
+  }
+  return instance;
+}
+
+void NDIReceiver::setFrameSyncSettings(const FrameSyncSettings &settings) {
+  if (settings.frameRateN <= 0 || settings.frameRateD <= 0 ||
+      settings.sampleRate <= 0 || settings.channels <= 0) {
+    NDIW_LOG_ERROR("invalid framesync settings, keeping the previous ones");
+    return;
+  }
+  frameSyncSettings_ = settings;
+}
+
+EndpointStatsSnapshot NDIReceiver::getStats() {
+  EndpointStatsSnapshot snapshot = NDIBase::getStats();
+  auto instance = currentInstance();
+  if (instance) {
+    NDIlib_recv_performance_t total;
+    NDIlib_recv_performance_t dropped;
+    lib->NDIlib_recv_get_performance(instance.get(), &total, &dropped);
+    snapshot.droppedVideoFrames = dropped.video_frames;
+    snapshot.droppedAudioFrames = dropped.audio_frames;
+    snapshot.droppedMetadataFrames = dropped.metadata_frames;
+
+    NDIlib_recv_queue_t queue;
+    lib->NDIlib_recv_get_queue(instance.get(), &queue);
+    snapshot.queuedVideoFrames = queue.video_frames;
+    snapshot.queuedAudioFrames = queue.audio_frames;
+    snapshot.queuedMetadataFrames = queue.metadata_frames;
+  }
+  return snapshot;
+}
+
+std::chrono::microseconds NDIReceiver::getLastSwitchLatency() const {
+  return std::chrono::microseconds(lastSwitchLatencyUs_.load());
+}
+
+void NDIReceiver::setStandbySources(const std::vector<std::string> &sources,
+                                    NDIlib_recv_bandwidth_e bandwidth) {
+  std::map<std::string, StandbyConnection> dropped;
+  {
+    std::lock_guard<std::mutex> lock(standbyMutex_);
+    bool bandwidthChanged = bandwidth != standbyBandwidth_;
+    standbySources_ = std::set<std::string>(sources.begin(), sources.end());
+    standbyBandwidth_ = bandwidth;
+    for (auto it = standby_.begin(); it != standby_.end();) {
+      if (bandwidthChanged || !standbySources_.count(it->first)) {
+        dropped.insert(standby_.extract(it++));
+      } else {
+        ++it;
       }
+    }
+  }
+  // the dropped receivers are destroyed here outside of the lock
+  dropped.clear();
+  connectStandbySources();
+}
 
-      // Destroy the NDI finder instance
-      lib->NDIlib_find_destroy(pNDI_find);
-      // Update the member variable with the new list
+NDIReceiver::InstanceHandle
+NDIReceiver::createRecvInstance(const std::string &name, const std::string &url,
+                                NDIlib_recv_bandwidth_e bandwidth) {
+  NDIlib_recv_create_v3_t recv_desc;
+  recv_desc.source_to_connect_to.p_ndi_name = name.c_str();
+  recv_desc.source_to_connect_to.p_url_address =
+      url.empty() ? nullptr : url.c_str();
+  recv_desc.color_format =
+      NDIlib_recv_color_format_e_RGBX_RGBA; // Example format
+  recv_desc.bandwidth = bandwidth;
+  return InstanceHandle(lib->NDIlib_recv_create_v3(&recv_desc),
+                        [lib = lib](NDIlib_recv_instance_t p) {
+                          if (p) {
+                            lib->NDIlib_recv_destroy(p);
+                          }
+                        });
+}
 
-      {
-        std::lock_guard<std::mutex> lock(sourceMutex_);
-        ndiSources_ = tempSources;
+NDIReceiver::StandbyConnection
+NDIReceiver::takeStandby(const std::string &name) {
+  std::lock_guard<std::mutex> lock(standbyMutex_);
+  auto it = standby_.find(name);
+  if (it == standby_.end()) {
+    return {};
+  }
+  StandbyConnection connection = std::move(it->second);
+  standby_.erase(it);
+  return connection;
+}
+
+void NDIReceiver::returnToStandby(const std::string &name,
+                                  const std::string &url,
+                                  NDIlib_recv_bandwidth_e bandwidth,
+                                  InstanceHandle instance) {
+  if (!instance) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(standbyMutex_);
+  if (standbySources_.count(name) && !standby_.count(name) &&
+      bandwidth == standbyBandwidth_) {
+    standby_[name] = {url, std::move(instance), bandwidth};
+  }
+  // otherwise the last reference goes when the handle leaves the scope
+}
+
+void NDIReceiver::connectStandbySources() {
+  auto sources = sourcesSnapshot();
+  std::lock_guard<std::mutex> outputLock(setOutputMutex_);
+  std::lock_guard<std::mutex> lock(standbyMutex_);
+  for (const auto &name : standbySources_) {
+    if (standby_.count(name) || name == currentOutput_.name) {
+      continue;
+    }
+    auto source = sources->find(name);
+    if (source == sources->end()) {
+      // connected once the discovery finds it
+      continue;
+    }
+    auto instance = createRecvInstance(name, source->second, standbyBandwidth_);
+    if (instance) {
+      standby_[name] = {source->second, std::move(instance), standbyBandwidth_};
+    }
+  }
+}
+
+void NDIReceiver::refreshStandby(const std::vector<NDISourceEvent> &events) {
+  std::vector<StandbyConnection> dropped;
+  bool connect = false;
+  {
+    std::lock_guard<std::mutex> lock(standbyMutex_);
+    for (const auto &event : events) {
+      if (!standbySources_.count(event.name)) {
+        continue;
+      }
+      connect = true;
+      auto it = standby_.find(event.name);
+      if (event.type == NDISourceEventType::Changed && it != standby_.end()) {
+        // reconnect to the new address
+        dropped.push_back(std::move(it->second));
+        standby_.erase(it);
       }
     }
-  } catch (const std::exception &e) {
-    Logger::log_error("failed to get sources", e.what());
+  }
+  dropped.clear();
+  if (connect) {
+    connectStandbySources();
+  }
+}
+
+void NDIReceiver::resetSources() {
+  stop();
+  // start picks the discovery that matches the current group settings
+  std::atomic_store(&discovery_, std::shared_ptr<NDISourceDiscovery>());
+  start();
+}
+
+void NDIReceiver::onSourceEvents(const std::vector<NDISourceEvent> &events) {
+  // done here and not in the thread pool so that nothing touches the
+  // receiver after stopSourceFinding has unsubscribed
+  refreshStandby(events);
+
+  std::lock_guard<std::mutex> lock(ndiSourceCallbackMutex_);
+  for (const auto &event : events) {
+    for (const auto &callback : _ndiSourceEventCallbacks) {
+      threadPool_->enqueue([=]() { callback(event); });
+    }
+    if (event.type != NDISourceEventType::Added) {
+      continue;
+    }
+    for (const auto &callback : _ndiSourceCallbacks) {
+      std::string sourceName = event.name;
+      threadPool_->enqueue([=]() { callback(sourceName); });
+    }
   }
 }
 
+std::shared_ptr<const NDISourceMap> NDIReceiver::sourcesSnapshot() {
+  auto discovery = std::atomic_load(&discovery_);
+  if (!discovery) {
+    return std::make_shared<const NDISourceMap>();
+  }
+  return discovery->snapshot();
+}
+
 std::vector<std::string> NDIReceiver::getCurrentSources() {
-  std::lock_guard<std::mutex> lock(sourceMutex_);
+  auto snapshot = sourcesSnapshot();
   std::vector<std::string> sources;
-  for (const auto &pair : ndiSources_) {
+  sources.reserve(snapshot->size());
+  for (const auto &pair : *snapshot) {
     sources.push_back(pair.first);
   }
   return sources;
@@ -267,6 +652,17 @@ std::vector<std::string> NDIReceiver::getCurrentSources() {
 
 void NDIReceiver::generateFrames() {
   uint32_t sleeptimeMS = 16;
+  // the framesync mode is paced by the output clock, frame n is due at
+  // clockStart + n * period
+  const FrameSyncSettings frameSyncSettings = frameSyncSettings_;
+  const auto framePeriod =
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(
+              static_cast<double>(frameSyncSettings.frameRateD) /
+              frameSyncSettings.frameRateN));
+  auto clockStart = std::chrono::steady_clock::now();
+  int64_t frameIndex = 0;
+
   auto lastVideoFrameTime = std::chrono::steady_clock::now();
   auto lastAudioFrameTime = std::chrono::steady_clock::now();
   const auto disconnectionThreshold = std::chrono::milliseconds(500);
@@ -274,25 +670,26 @@ void NDIReceiver::generateFrames() {
   bool videoConnected = false;
   bool audioConnected = false;
 
-  common_types::Image blankFrame;
-  blankFrame.width = 400;
-  blankFrame.height = 400;
-  blankFrame.channels = 4;
-  blankFrame.data = std::vector<uint8_t>(
-      blankFrame.width * blankFrame.height * blankFrame.channels,
-      0); // Fill with zeros for a blank frame
-  blankFrame.stride =
-      blankFrame.width * blankFrame.channels; // Assuming no padding
+  auto blank = std::make_shared<common_types::Image>();
+  blank->width = 400;
+  blank->height = 400;
+  blank->channels = 4;
+  blank->data = std::vector<uint8_t>(blank->width * blank->height *
+                                         blank->channels,
+                                     0); // Fill with zeros for a blank frame
+  blank->stride = blank->width * blank->channels; // Assuming no padding
+  std::shared_ptr<const common_types::Image> blankFrame = std::move(blank);
 
   try {
     while (isReceivingRunning_.load()) {
-      int waitTimeMs = 33;
       // Check if the selected source has changed
       if (dontTryToSetSource_.load()) {
-        {
+        if (carriesVideo(bandwidth_.load())) {
+          auto now = std::chrono::steady_clock::now();
           std::lock_guard<std::mutex> lock(frameCallbackVecMutex_);
-          for (const auto &callback : _frameCallbacks) {
-            threadPool_.enqueue([=]() { callback(blankFrame); });
+          for (auto &subscriber : _frameCallbacks) {
+            subscriber.select(now);
+            subscriber.dispatch(*threadPool_, blankFrame, stats_, now);
           }
         }
 
@@ -305,17 +702,32 @@ void NDIReceiver::generateFrames() {
             std::chrono::milliseconds(sleeptimeMS * 10));
         continue;
       }
+      if (bandwidthRestorePending_.load()) {
+        finishBandwidthRestore();
+      }
+      if (currentBandwidth_.load() == NDIlib_recv_bandwidth_metadata_only) {
+        // nothing to capture here, the metadata thread receives everything
+        std::this_thread::sleep_for(std::chrono::milliseconds(sleeptimeMS));
+        continue;
+      }
       // Capture video frames from the receiver
       {
         NDIFrame frames;
+        // the same format for the capture and the conversions below
+        auto audioFormat = std::atomic_load(&audioFormat_);
+        AudioLayout audioLayout = audioFormat->layout;
 
         if (m_synced) {
-          frames = getFramesNDISynced();
+          frames = getFramesNDISynced(frameSyncSettings, frameIndex,
+                                      *audioFormat);
         } else {
-          frames = getFrameNDI();
+          frames = getFrameNDI(*audioFormat);
         }
         auto &[audioOpt, imageOpt] = frames;
+        auto captured = std::chrono::steady_clock::now();
+        auto stats = stats_;
         if (audioOpt.has_value()) {
+          stats->audioFrames.fetch_add(1, std::memory_order_relaxed);
           auto audio = audioOpt.value();
           lastAudioFrameTime = std::chrono::steady_clock::now();
           if (!audioConnected) {
@@ -333,8 +745,38 @@ void NDIReceiver::generateFrames() {
           // Call audio frame callbacks
           {
             std::lock_guard<std::mutex> lock(audioCallbackVecMutex_);
+            NDIW_TRACE_SCOPE("enqueue callbacks");
             for (const auto &callback : _audioCallbacks) {
-              threadPool_.enqueue([=]() { callback(audio.data); });
+              threadPool_->enqueue([=]() {
+                stats->callbackLatency.record(
+                    std::chrono::steady_clock::now() - captured);
+                NDIW_TRACE_SCOPE("audio callback");
+                callback(audio.data);
+              });
+            }
+            if (!_audio16Callbacks.empty()) {
+              Audio16 audio16;
+              AudioConversion::toAudio16(audio.data, audioLayout, audio16);
+              for (const auto &callback : _audio16Callbacks) {
+                threadPool_->enqueue([=]() {
+                  stats->callbackLatency.record(
+                      std::chrono::steady_clock::now() - captured);
+                  NDIW_TRACE_SCOPE("audio callback");
+                  callback(audio16);
+                });
+              }
+            }
+            if (!_audio24Callbacks.empty()) {
+              Audio24 audio24;
+              AudioConversion::toAudio24(audio.data, audioLayout, audio24);
+              for (const auto &callback : _audio24Callbacks) {
+                threadPool_->enqueue([=]() {
+                  stats->callbackLatency.record(
+                      std::chrono::steady_clock::now() - captured);
+                  NDIW_TRACE_SCOPE("audio callback");
+                  callback(audio24);
+                });
+              }
             }
           }
         } else if (audioConnected &&
@@ -351,8 +793,9 @@ void NDIReceiver::generateFrames() {
           }
         }
         if (imageOpt.has_value()) {
+          stats->videoFrames.fetch_add(1, std::memory_order_relaxed);
           lastVideoFrameTime = std::chrono::steady_clock::now();
-          const auto &frame = imageOpt.value();
+          auto &frame = imageOpt.value();
           if (!videoConnected) {
             videoConnected = true;
             if (_videoConnected) {
@@ -363,16 +806,23 @@ void NDIReceiver::generateFrames() {
             std::lock_guard<std::mutex> lock(frameMutex_);
             currentFrame_ = frame.data;
           }
+          // one copy shared by the queued callbacks, each callback copies
+          // it only when it is called
+          auto shared =
+              std::make_shared<const DataWithMetadata<Image>>(std::move(frame));
+          std::shared_ptr<const Image> sharedImage(shared, &shared->data);
           {
             std::lock_guard<std::mutex> lock(frameCallbackVecMutex_);
-            for (const auto &callback : _frameCallbacks) {
-              threadPool_.enqueue([=]() { callback(frame.data); });
+            NDIW_TRACE_SCOPE("enqueue callbacks");
+            for (auto &subscriber : _frameCallbacks) {
+              subscriber.dispatch(*threadPool_, sharedImage, stats, captured);
             }
           }
           {
             std::lock_guard<std::mutex> lock(frameCallbackVecMutexMetadata_);
-            for (const auto &callback : _frameWithMetadataCallbacks) {
-              threadPool_.enqueue([=]() { callback(frame); });
+            NDIW_TRACE_SCOPE("enqueue callbacks");
+            for (auto &subscriber : _frameWithMetadataCallbacks) {
+              subscriber.dispatch(*threadPool_, shared, stats, captured);
             }
           }
         } else if (videoConnected &&
@@ -385,125 +835,159 @@ void NDIReceiver::generateFrames() {
         }
       }
 
-      std::this_thread::sleep_for(
-          std::chrono::milliseconds(m_synced ? waitTimeMs : 1));
+      if (m_synced) {
+        frameIndex++;
+        auto due = clockStart + framePeriod * frameIndex;
+        auto now = std::chrono::steady_clock::now();
+        if (now - due > framePeriod) {
+          // fell behind by more than a frame, start the clock again instead
+          // of bursting frames to catch up
+          clockStart = now;
+          frameIndex = 0;
+        } else {
+          std::this_thread::sleep_until(due);
+        }
+      } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
     }
   } catch (const std::exception &e) {
-    Logger::log_error("Could not generate frames", e.what());
+    NDIW_LOG_ERROR("Could not generate frames", e.what());
   }
 }
 
-NDIFrame NDIReceiver::getFrameNDI() {
+NDIFrame NDIReceiver::getFrameNDI(const AudioFormat &audioFormat) {
   NDIlib_video_frame_v2_t video_frame;
   NDIlib_audio_frame_v2_t audio_frame;
 
-  std::lock_guard<std::mutex> lock(pndiMutex_);
-  auto type =
-      lib->NDIlib_recv_capture_v2(pNDIInstance_, &video_frame, &audio_frame,
-                                  nullptr, 1000); // 5-second timeout
+  auto instance = currentInstance();
+  if (!instance) {
+    return {std::nullopt, std::nullopt};
+  }
+  // without the video pointer the sdk does not hand us video frames at all
+  bool video = carriesVideo(currentBandwidth_.load());
+  NDIlib_frame_type_e type;
+  {
+    NDIW_TRACE_SCOPE("capture");
+    type = lib->NDIlib_recv_capture_v2(
+        instance.get(), video ? &video_frame : nullptr, &audio_frame, nullptr,
+        1000); // 1-second timeout
+  }
 
+  auto recorder = std::atomic_load(&recorder_);
   if (type == NDIlib_frame_type_e::NDIlib_frame_type_audio) {
+    if (recorder) {
+      NDIW_TRACE_SCOPE("record audio");
+      recorder->recordAudio(audio_frame);
+    }
 
     // Process and convert the NDI audio frame to your Audio struct
     DataWithMetadata<Audio> fullframe;
-    fullframe.data.sampleRate = audio_frame.sample_rate;
-    fullframe.data.channels = audio_frame.no_channels;
-    fullframe.data.noSamples = audio_frame.no_samples;
-    fullframe.data.data.assign(
-        audio_frame.p_data,
-        audio_frame.p_data + audio_frame.no_samples * audio_frame.no_channels);
-    fullframe.data.isNew = true;
-    fullframe.data.timestamp = audio_frame.timestamp * 100;
-    lib->NDIlib_recv_free_audio_v2(pNDIInstance_, &audio_frame);
+    {
+      NDIW_TRACE_SCOPE("copy audio");
+      auto copyStart = std::chrono::steady_clock::now();
+      AudioConversion::toAudio(audio_frame, audioFormat, fullframe.data);
+      stats_->copyTime.record(std::chrono::steady_clock::now() - copyStart);
+    }
+    lib->NDIlib_recv_free_audio_v2(instance.get(), &audio_frame);
     return {fullframe, std::nullopt};
   } else if (type == NDIlib_frame_type_e::NDIlib_frame_type_video) {
+    if (recorder) {
+      NDIW_TRACE_SCOPE("record video");
+      recorder->recordVideo(video_frame);
+    }
+    dispatchScaledFrames(video_frame);
     DataWithMetadata<Image> fullframe;
-    fullframe.data.width = video_frame.xres;
-    fullframe.data.height = video_frame.yres;
-    fullframe.data.channels = 4; // Assuming RGBA format
-    fullframe.data.timestamp = video_frame.timestamp * 100;
-    fullframe.data.data.assign(video_frame.p_data,
-                               video_frame.p_data +
-                                   video_frame.xres * video_frame.yres *
-                                       fullframe.data.channels);
-
-    if (video_frame.p_metadata) {
-      fullframe.metadata = Metadata::decode(video_frame.p_metadata);
-      /*auto container  = Metadata::decode(video_frame.p_metadata);
-      if (container.accelerometerData.has_value()) {
-              const auto& accelData = container.accelerometerData.value();
-              Logger::log_info("accel x", std::to_string(accelData.x), ", accel
-      y:", std::to_string(accelData.y), ", accel z",
-      std::to_string(accelData.z));
-      }
-      if (container.gyroscopeData.has_value()) {
-              const auto& gyroData = container.gyroscopeData.value();
-              Logger::log_info("gyro x", std::to_string(gyroData.x), ", gyro
-      y:", std::to_string(gyroData.y), ", gyro z", std::to_string(gyroData.z));
-      }*/
+    {
+      NDIW_TRACE_SCOPE("copy video");
+      auto copyStart = std::chrono::steady_clock::now();
+      fullframe = FrameConversion::toImageWithMetadata(
+          video_frame,
+          selectFullFrameSubscribers(std::chrono::steady_clock::now()));
+      stats_->copyTime.record(std::chrono::steady_clock::now() - copyStart);
+    }
+    if (!sensorBuffer_.empty()) {
+      sensorBuffer_.align(fullframe, video_frame.timecode,
+                          FrameConversion::frameDuration(video_frame));
     }
-    lib->NDIlib_recv_free_video_v2(pNDIInstance_, &video_frame);
+    lib->NDIlib_recv_free_video_v2(instance.get(), &video_frame);
     return {std::nullopt, fullframe};
   }
   return {std::nullopt, std::nullopt};
 }
 
-// TODO: this does not work fix it :D
-NDIFrame NDIReceiver::getFramesNDISynced() {
+NDIFrame NDIReceiver::getFramesNDISynced(const FrameSyncSettings &settings,
+                                         int64_t frameIndex,
+                                         const AudioFormat &audioFormat) {
   NDIlib_video_frame_v2_t video_frame;
   NDIlib_audio_frame_v2_t audio_frame;
-  std::lock_guard<std::mutex> lock(pndiMutex_);
+  FrameSyncHandle frameSync;
+  {
+    std::lock_guard<std::mutex> lock(pndiMutex_);
+    frameSync = _pndiFrameSync;
+  }
+  if (!frameSync) {
+    return {std::nullopt, std::nullopt};
+  }
 
-  // Capture synced audio frame
-  lib->NDIlib_framesync_capture_audio(_pndiFrameSync, &audio_frame, 48000, 2,
-                                      800);
-  DataWithMetadata<Audio> fullAudioFrame;
+  // Capture the audio of one output frame, the sample counts of consecutive
+  // frames differ by one when the rate does not divide evenly eg. 48000 Hz at
+  // 29.97 fps so they add up to the sample rate over time
+  int64_t samplesPerSecondD =
+      static_cast<int64_t>(settings.sampleRate) * settings.frameRateD;
+  int noSamples = static_cast<int>(
+      (frameIndex + 1) * samplesPerSecondD / settings.frameRateN -
+      frameIndex * samplesPerSecondD / settings.frameRateN);
+  auto recorder = std::atomic_load(&recorder_);
+  std::optional<DataWithMetadata<Audio>> audio;
+  {
+    NDIW_TRACE_SCOPE("framesync capture audio");
+    lib->NDIlib_framesync_capture_audio(frameSync.get(), &audio_frame,
+                                        settings.sampleRate, settings.channels,
+                                        noSamples);
+  }
   if (audio_frame.p_data) {
-    fullAudioFrame.data.sampleRate = audio_frame.sample_rate;
-    fullAudioFrame.data.channels = audio_frame.no_channels;
-    fullAudioFrame.data.noSamples = audio_frame.no_samples;
-    fullAudioFrame.data.data.assign(
-        audio_frame.p_data,
-        audio_frame.p_data + audio_frame.no_samples * audio_frame.no_channels);
-    fullAudioFrame.data.isNew = true;
-    lib->NDIlib_framesync_free_audio(_pndiFrameSync, &audio_frame);
-  }
-
-  // Capture synced video frame
-  lib->NDIlib_framesync_capture_video(_pndiFrameSync, &video_frame,
-                                      NDIlib_frame_format_type_progressive);
-  DataWithMetadata<Image> fullImageFrame;
+    if (recorder) {
+      NDIW_TRACE_SCOPE("record audio");
+      recorder->recordAudio(audio_frame);
+    }
+    NDIW_TRACE_SCOPE("copy audio");
+    auto copyStart = std::chrono::steady_clock::now();
+    audio.emplace();
+    AudioConversion::toAudio(audio_frame, audioFormat, audio->data);
+    stats_->copyTime.record(std::chrono::steady_clock::now() - copyStart);
+    lib->NDIlib_framesync_free_audio(frameSync.get(), &audio_frame);
+  }
+
+  // Capture synced video frame, the framesync repeats the last frame or gives
+  // nothing if no frame has come yet
+  std::optional<DataWithMetadata<Image>> image;
+  if (!carriesVideo(currentBandwidth_.load())) {
+    return {audio, image};
+  }
+  {
+    NDIW_TRACE_SCOPE("framesync capture video");
+    lib->NDIlib_framesync_capture_video(frameSync.get(), &video_frame,
+                                        NDIlib_frame_format_type_progressive);
+  }
   if (video_frame.p_data) {
-    fullImageFrame.data.width = video_frame.xres;
-    fullImageFrame.data.height = video_frame.yres;
-    fullImageFrame.data.channels = 4; // Assuming RGBA format
-    fullImageFrame.data.data.assign(video_frame.p_data,
-                                    video_frame.p_data +
-                                        video_frame.xres * video_frame.yres *
-                                            fullImageFrame.data.channels);
-    if (video_frame.p_metadata) {
-      MetadataContainer container = Metadata::decode(video_frame.p_metadata);
-
-      if (container.accelerometerData.has_value()) {
-        const auto &accelData = container.accelerometerData.value();
-        Logger::log_info("accel x", std::to_string(accelData.x),
-                         ", accel y:", std::to_string(accelData.y), ", accel z",
-                         std::to_string(accelData.z));
-      }
-      if (container.gyroscopeData.has_value()) {
-        const auto &gyroData = container.gyroscopeData.value();
-        Logger::log_info("gyro x", std::to_string(gyroData.x),
-                         ", gyro y:", std::to_string(gyroData.y), ", gyro z",
-                         std::to_string(gyroData.z));
-      }
+    if (recorder) {
+      NDIW_TRACE_SCOPE("record video");
+      recorder->recordVideo(video_frame);
     }
-    lib->NDIlib_framesync_free_video(_pndiFrameSync, &video_frame);
+    dispatchScaledFrames(video_frame);
+    NDIW_TRACE_SCOPE("copy video");
+    auto copyStart = std::chrono::steady_clock::now();
+    image = FrameConversion::toImageWithMetadata(
+        video_frame,
+        selectFullFrameSubscribers(std::chrono::steady_clock::now()));
+    stats_->copyTime.record(std::chrono::steady_clock::now() - copyStart);
+    if (!sensorBuffer_.empty()) {
+      sensorBuffer_.align(*image, video_frame.timecode,
+                          FrameConversion::frameDuration(video_frame));
+    }
+    lib->NDIlib_framesync_free_video(frameSync.get(), &video_frame);
   }
 
-  return {audio_frame.p_data
-              ? std::optional<DataWithMetadata<Audio>>{fullAudioFrame}
-              : std::nullopt,
-          video_frame.p_data
-              ? std::optional<DataWithMetadata<Image>>{fullImageFrame}
-              : std::nullopt};
-}
\ No newline at end of file
+  return {audio, image};
+}
@@ -0,0 +1,363 @@
+#include "NDIReceiverGroup.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#include "FrameConversion.hpp"
+#include "Trace.hpp"
+#include "NDIWLog.hpp"
+#include "NDILibraryManager.hpp"
+
+namespace {
+// how long a thread with a single source waits in the sdk
+constexpr uint32_t kSingleSourceTimeoutMs = 100;
+// how long a thread with many sources sleeps when none of them had anything
+constexpr auto kIdleSleep = std::chrono::milliseconds(1);
+// frames taken from one source per pass so a busy source can not starve the
+// others of the same thread
+constexpr int kMaxFramesPerPass = 4;
+} // namespace
+
+NDIReceiverGroup::NDIReceiverGroup(const std::string &groupToFind,
+                                   bool findGroup, size_t captureThreads,
+                                   NDIlib_recv_bandwidth_e bandwidth,
+                                   std::shared_ptr<ThreadPool> callbackPool)
+    : groupToFind_(groupToFind), findGroup_(findGroup), bandwidth_(bandwidth),
+      connectionsVersion_(0), running_(false),
+      threadPool_(callbackPool ? std::move(callbackPool)
+                               : std::make_shared<ThreadPool>(4)) {
+  if (captureThreads == 0) {
+    captureThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  workerConnections_.resize(captureThreads);
+
+  lib = NDILibraryManager::Acquire(); // Loads + initializes if first
+  if (!lib) {
+    throw std::runtime_error("Failed to load the NDI library");
+  }
+}
+
+NDIReceiverGroup::~NDIReceiverGroup() {
+  stop();
+  {
+    std::lock_guard<std::mutex> lock(connectionMutex_);
+    workerConnections_.clear();
+  }
+  NDILibraryManager::Release();
+}
+
+void NDIReceiverGroup::start() {
+  if (running_.exchange(true)) {
+    NDIW_LOG_WARN("receiver group already running");
+    return;
+  }
+  auto discovery = this->discovery();
+  if (!discovery) {
+    discovery = NDISourceDiscovery::acquire(groupToFind_, findGroup_);
+    std::lock_guard<std::mutex> lock(discoveryMutex_);
+    discovery_ = discovery;
+  }
+  if (discovery) {
+    // subscribe can call back right away, the lock is not held for it
+    size_t listenerId = discovery->subscribe(
+        [this](const std::vector<NDISourceEvent> &events) {
+          onSourceEvents(events);
+        });
+    std::lock_guard<std::mutex> lock(discoveryMutex_);
+    sourceListenerId_ = listenerId;
+  } else {
+    NDIW_LOG_ERROR("could not start source finding for the receiver group");
+  }
+  for (size_t i = 0; i < workerConnections_.size(); i++) {
+    captureThreads_.emplace_back(&NDIReceiverGroup::captureLoop, this, i);
+  }
+}
+
+void NDIReceiverGroup::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  std::shared_ptr<NDISourceDiscovery> discovery;
+  size_t listenerId;
+  {
+    std::lock_guard<std::mutex> lock(discoveryMutex_);
+    discovery = discovery_;
+    listenerId = sourceListenerId_;
+  }
+  if (discovery) {
+    // waits for a running callback, which needs discoveryMutex_
+    discovery->unsubscribe(listenerId);
+  }
+  for (auto &thread : captureThreads_) {
+    thread.join();
+  }
+  captureThreads_.clear();
+
+  // disconnect, the receivers are created again when the sources are found
+  std::lock_guard<std::mutex> lock(connectionMutex_);
+  for (auto &connections : workerConnections_) {
+    for (auto &connection : connections) {
+      connection->instance.reset();
+    }
+  }
+  connectionsVersion_++;
+}
+
+bool NDIReceiverGroup::addSource(const std::string &name) {
+  auto discovery = this->discovery();
+  std::lock_guard<std::mutex> lock(connectionMutex_);
+  for (const auto &connections : workerConnections_) {
+    for (const auto &connection : connections) {
+      if (connection->name == name) {
+        return false;
+      }
+    }
+  }
+  auto connection = std::make_shared<Connection>();
+  connection->name = name;
+  if (discovery && running_.load()) {
+    connect(*connection, *discovery->snapshot());
+  }
+  workerConnections_[leastLoadedWorker()].push_back(connection);
+  connectionsVersion_++;
+  return true;
+}
+
+void NDIReceiverGroup::removeSource(const std::string &name) {
+  std::lock_guard<std::mutex> lock(connectionMutex_);
+  for (auto &connections : workerConnections_) {
+    connections.erase(
+        std::remove_if(connections.begin(), connections.end(),
+                       [&name](const std::shared_ptr<Connection> &connection) {
+                         return connection->name == name;
+                       }),
+        connections.end());
+  }
+  connectionsVersion_++;
+  // the capture thread may still hold the connection, the receiver is
+  // destroyed when it lets go of it
+}
+
+std::vector<std::string> NDIReceiverGroup::getSources() {
+  std::lock_guard<std::mutex> lock(connectionMutex_);
+  std::vector<std::string> sources;
+  for (const auto &connections : workerConnections_) {
+    for (const auto &connection : connections) {
+      sources.push_back(connection->name);
+    }
+  }
+  return sources;
+}
+
+std::vector<std::string> NDIReceiverGroup::getAvailableSources() {
+  std::vector<std::string> sources;
+  auto discovery = this->discovery();
+  if (!discovery) {
+    return sources;
+  }
+  for (const auto &pair : *discovery->snapshot()) {
+    sources.push_back(pair.first);
+  }
+  return sources;
+}
+
+void NDIReceiverGroup::addFrameCallback(GroupFrameCallback callback) {
+  std::lock_guard<std::mutex> lock(callbackMutex_);
+  frameCallbacks_.push_back(callback);
+}
+
+void NDIReceiverGroup::addAudioCallback(GroupAudioCallback callback) {
+  std::lock_guard<std::mutex> lock(callbackMutex_);
+  audioCallbacks_.push_back(callback);
+}
+
+void NDIReceiverGroup::addMetadataCallback(GroupMetadataCallback callback) {
+  std::lock_guard<std::mutex> lock(callbackMutex_);
+  metadataCallbacks_.push_back(callback);
+}
+
+void NDIReceiverGroup::onSourceEvents(
+    const std::vector<NDISourceEvent> &events) {
+  auto discovery = this->discovery();
+  if (!discovery) {
+    return;
+  }
+  auto sources = discovery->snapshot();
+  std::lock_guard<std::mutex> lock(connectionMutex_);
+  for (auto &connections : workerConnections_) {
+    for (auto &connection : connections) {
+      for (const auto &event : events) {
+        if (event.name != connection->name ||
+            event.type == NDISourceEventType::Removed) {
+          // the sdk reconnects by itself if a removed source comes back
+          continue;
+        }
+        if (event.type == NDISourceEventType::Changed) {
+          connection->instance.reset();
+          connectionsVersion_++;
+        }
+        connect(*connection, *sources);
+      }
+    }
+  }
+}
+
+void NDIReceiverGroup::connect(Connection &connection,
+                               const NDISourceMap &sources) {
+  if (connection.instance) {
+    return;
+  }
+  auto source = sources.find(connection.name);
+  if (source == sources.end()) {
+    return;
+  }
+  connection.url = source->second;
+
+  NDIlib_recv_create_v3_t recv_desc;
+  recv_desc.source_to_connect_to.p_ndi_name = connection.name.c_str();
+  recv_desc.source_to_connect_to.p_url_address =
+      connection.url.empty() ? nullptr : connection.url.c_str();
+  recv_desc.color_format = NDIlib_recv_color_format_e_RGBX_RGBA;
+  recv_desc.bandwidth = bandwidth_;
+  auto instance = lib->NDIlib_recv_create_v3(&recv_desc);
+  if (!instance) {
+    NDIW_LOG_ERROR("could not connect to", connection.name);
+    return;
+  }
+  connection.instance = InstanceHandle(
+      instance,
+      [lib = lib](NDIlib_recv_instance_t p) { lib->NDIlib_recv_destroy(p); });
+  connectionsVersion_++;
+  NDIW_LOG_INFO("receiver group connected to", connection.name);
+}
+
+std::shared_ptr<NDISourceDiscovery> NDIReceiverGroup::discovery() {
+  std::lock_guard<std::mutex> lock(discoveryMutex_);
+  return discovery_;
+}
+
+size_t NDIReceiverGroup::leastLoadedWorker() const {
+  size_t worker = 0;
+  for (size_t i = 1; i < workerConnections_.size(); i++) {
+    if (workerConnections_[i].size() < workerConnections_[worker].size()) {
+      worker = i;
+    }
+  }
+  return worker;
+}
+
+void NDIReceiverGroup::captureLoop(size_t worker) {
+  // copies of the connections so the lock is not held while capturing, they
+  // are copied again only when the connections change
+  std::vector<Connection> connections;
+  uint64_t copiedVersion = 0;
+  try {
+    while (running_.load()) {
+      if (copiedVersion != connectionsVersion_.load()) {
+        std::lock_guard<std::mutex> lock(connectionMutex_);
+        copiedVersion = connectionsVersion_.load();
+        connections.clear();
+        for (const auto &connection : workerConnections_[worker]) {
+          if (connection->instance) {
+            connections.push_back(*connection);
+          }
+        }
+      }
+      if (connections.empty()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        continue;
+      }
+      if (connections.size() == 1) {
+        capture(connections.front(), kSingleSourceTimeoutMs);
+        continue;
+      }
+
+      bool capturedAny = false;
+      for (const auto &connection : connections) {
+        for (int i = 0; i < kMaxFramesPerPass && capture(connection, 0); i++) {
+          capturedAny = true;
+        }
+      }
+      if (!capturedAny) {
+        std::this_thread::sleep_for(kIdleSleep);
+      }
+    }
+  } catch (const std::exception &e) {
+    NDIW_LOG_ERROR("receiver group capture failed", e.what());
+  }
+}
+
+bool NDIReceiverGroup::capture(const Connection &connection,
+                               uint32_t timeoutMs) {
+  NDIlib_video_frame_v2_t video_frame;
+  NDIlib_audio_frame_v2_t audio_frame;
+  NDIlib_metadata_frame_t metadata_frame;
+  auto instance = connection.instance.get();
+  // only ask for what the bandwidth carries so the sdk skips the rest
+  bool video = bandwidth_ != NDIlib_recv_bandwidth_audio_only &&
+               bandwidth_ != NDIlib_recv_bandwidth_metadata_only;
+  bool audio = bandwidth_ != NDIlib_recv_bandwidth_metadata_only;
+  NDIlib_frame_type_e type;
+  {
+    NDIW_TRACE_SCOPE("group capture");
+    type = lib->NDIlib_recv_capture_v2(
+        instance, video ? &video_frame : nullptr,
+        audio ? &audio_frame : nullptr, &metadata_frame, timeoutMs);
+  }
+
+  switch (type) {
+  case NDIlib_frame_type_video: {
+    // one copy shared by the callbacks, each gets its own only when called
+    auto image = std::make_shared<common_types::Image>();
+    {
+      NDIW_TRACE_SCOPE("copy video");
+      FrameConversion::toImage(video_frame, *image);
+    }
+    lib->NDIlib_recv_free_video_v2(instance, &video_frame);
+    std::shared_ptr<const common_types::Image> frame = std::move(image);
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    for (const auto &callback : frameCallbacks_) {
+      threadPool_->enqueue([callback, name = connection.name, frame]() {
+        NDIW_TRACE_SCOPE("frame callback");
+        callback(name, *frame);
+      });
+    }
+    return true;
+  }
+  case NDIlib_frame_type_audio: {
+    auto audio = std::make_shared<common_types::Audio>();
+    {
+      NDIW_TRACE_SCOPE("copy audio");
+      FrameConversion::toAudio(audio_frame, *audio);
+    }
+    lib->NDIlib_recv_free_audio_v2(instance, &audio_frame);
+    std::shared_ptr<const common_types::Audio> samples = std::move(audio);
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    for (const auto &callback : audioCallbacks_) {
+      threadPool_->enqueue([callback, name = connection.name, samples]() {
+        NDIW_TRACE_SCOPE("audio callback");
+        callback(name, *samples);
+      });
+    }
+    return true;
+  }
+  case NDIlib_frame_type_metadata: {
+    if (metadata_frame.p_data &&
+        Metadata::isEncodedMetadata(metadata_frame.p_data)) {
+      MetadataContainer container = Metadata::decode(metadata_frame.p_data);
+      std::lock_guard<std::mutex> lock(callbackMutex_);
+      for (const auto &callback : metadataCallbacks_) {
+        threadPool_->enqueue([callback, name = connection.name, container]() {
+          NDIW_TRACE_SCOPE("metadata callback");
+          callback(name, container);
+        });
+      }
+    }
+    lib->NDIlib_recv_free_metadata(instance, &metadata_frame);
+    return true;
+  }
+  default:
+    return false;
+  }
+}
@@ -1,24 +1,31 @@
 #include "NDISender.hpp"
+#include "StatsRegistry.hpp"
 #include <cstring>
 #include <exception>
 #include <mutex>
 #include <string>
 #include <thread>
 
-#include "Logger.hpp"
+#include "NDIWLog.hpp"
 
 NDISender::NDISender(const std::string &name, const std::string &group,
-                     bool enableVideo, bool enableAudio)
+                     bool enableVideo, bool enableAudio,
+                     std::shared_ptr<ThreadPool> callbackPool)
     : NDIBase(
-          [this](NDIlib_metadata_frame_t &metadataFrame) {
-            return lib->NDIlib_send_capture(pNDIInstance_, &metadataFrame, 0);
+          [this](NDIlib_send_instance_t instance,
+                 NDIlib_metadata_frame_t &metadataFrame, uint32_t timeoutMs) {
+            return lib->NDIlib_send_capture(instance, &metadataFrame,
+                                            timeoutMs);
           },
-          [this](NDIlib_metadata_frame_t &metadataFrame) {
-            lib->NDIlib_send_send_metadata(pNDIInstance_, &metadataFrame);
+          [this](NDIlib_send_instance_t instance,
+                 NDIlib_metadata_frame_t &metadataFrame) {
+            lib->NDIlib_send_send_metadata(instance, &metadataFrame);
           },
-          [this](NDIlib_metadata_frame_t &metadataFrame) {
-            lib->NDIlib_send_free_metadata(pNDIInstance_, &metadataFrame);
-          }) {
+          [this](NDIlib_send_instance_t instance,
+                 NDIlib_metadata_frame_t &metadataFrame) {
+            lib->NDIlib_send_free_metadata(instance, &metadataFrame);
+          },
+          std::move(callbackPool)) {
   NDIlib_send_create_t NDI_send_create_desc;
   NDI_send_create_desc.p_ndi_name = name.c_str();
   if (group.length() > 0) {
@@ -30,21 +37,32 @@ NDISender::NDISender(const std::string &name, const std::string &group,
 
   {
     std::lock_guard<std::mutex> lock(pndiMutex_);
-    pNDIInstance_ = lib->NDIlib_send_create(&NDI_send_create_desc);
-    if (!pNDIInstance_) {
+    auto instance = lib->NDIlib_send_create(&NDI_send_create_desc);
+    if (!instance) {
       throw std::runtime_error("Failed to create NDI send instance");
     }
+    pNDIInstance_ = InstanceHandle(
+        instance, [lib = lib](NDIlib_send_instance_t p) {
+          lib->NDIlib_send_destroy(p);
+        });
   }
   m_frameBuffers.resize(2);
+  m_metadataBuffers.resize(m_frameBuffers.size());
+  m_statsId = StatsRegistry::add(
+      "sender", [name]() { return name; }, [this]() { return getStats(); });
 }
 
 NDISender::~NDISender() {
+  StatsRegistry::remove(m_statsId);
   stop();
-  std::lock_guard<std::mutex> lock(pndiMutex_);
   if (pNDIInstance_) {
-    lib->NDIlib_send_destroy(pNDIInstance_);
-    pNDIInstance_ = nullptr;
+    // wait until the sdk has released the last async frame before the
+    // buffers it points to are destroyed
+    std::lock_guard<std::mutex> bufferLock(m_bufferMutex);
+    lib->NDIlib_send_send_video_async_v2(pNDIInstance_.get(), nullptr);
   }
+  std::lock_guard<std::mutex> lock(pndiMutex_);
+  pNDIInstance_.reset();
 }
 
 void NDISender::start() { startMetadataListening(); }
@@ -52,7 +70,8 @@ void NDISender::stop() { stopMetadataListening(); }
 
 void NDISender::feedFrame(Image &image, NDIlib_FourCC_video_type_e videoType) {
   if (!pNDIInstance_) {
-    Logger::log_error("Pndi send not initialized");
+    NDIW_LOG_ERROR_EVERY(1000, "Pndi send not initialized");
+    return;
   }
   NDIlib_video_frame_v2_t NDI_video_frame;
   NDI_video_frame.xres = image.width;  // Assuming Image has a width member
@@ -62,11 +81,15 @@ void NDISender::feedFrame(Image &image, NDIlib_FourCC_video_type_e videoType) {
       image.data.data(); // Assuming Image has a data member
   NDI_video_frame.line_stride_in_bytes = image.stride;
 
-  { lib->NDIlib_send_send_video_v2(pNDIInstance_, &NDI_video_frame); }
+  {
+    NDIW_TRACE_SCOPE("send video");
+    lib->NDIlib_send_send_video_v2(pNDIInstance_.get(), &NDI_video_frame);
+  }
+  stats_->videoFrames.fetch_add(1, std::memory_order_relaxed);
 }
 void NDISender::feedAudio(Audio &audio) {
   if (!pNDIInstance_) {
-    Logger::log_error("Pndi send not initialized for audio");
+    NDIW_LOG_ERROR_EVERY(1000, "Pndi send not initialized for audio");
     return;
   }
 
@@ -78,66 +101,87 @@ void NDISender::feedAudio(Audio &audio) {
   NDI_audio_frame.channel_stride_in_bytes =
       NDI_audio_frame.no_samples * sizeof(float);
 
-  { lib->NDIlib_send_send_audio_v2(pNDIInstance_, &NDI_audio_frame); }
+  {
+    NDIW_TRACE_SCOPE("send audio");
+    lib->NDIlib_send_send_audio_v2(pNDIInstance_.get(), &NDI_audio_frame);
+  }
+  stats_->audioFrames.fetch_add(1, std::memory_order_relaxed);
 }
 
-void NDISender::asyncFeedFrame(Image &image,
-                               NDIlib_FourCC_video_type_e videoType) {
+void NDISender::feedVideoFrame(const NDIlib_video_frame_v2_t &frame,
+                               bool async) {
   if (!pNDIInstance_) {
-    Logger::log_error("Pndi send not initialized");
+    NDIW_LOG_ERROR_EVERY(1000, "Pndi send not initialized");
     return;
   }
-
-  int bufferIndex;
-  {
-    // Lock the buffer for writing
+  if (async) {
     std::lock_guard<std::mutex> lock(m_bufferMutex);
+    NDIW_TRACE_SCOPE("send video async");
+    lib->NDIlib_send_send_video_async_v2(pNDIInstance_.get(), &frame);
+  } else {
+    NDIW_TRACE_SCOPE("send video");
+    lib->NDIlib_send_send_video_v2(pNDIInstance_.get(), &frame);
+  }
+  stats_->videoFrames.fetch_add(1, std::memory_order_relaxed);
+}
 
-    // Swap the image with the current buffer to avoid deep copy
-    std::swap(m_frameBuffers[m_currentBufferIndex], image);
-
-    // Use the current buffer index for NDI frame preparation
-    bufferIndex = m_currentBufferIndex;
+void NDISender::feedAudioFrame(const NDIlib_audio_frame_v2_t &frame) {
+  if (!pNDIInstance_) {
+    NDIW_LOG_ERROR_EVERY(1000, "Pndi send not initialized for audio");
+    return;
+  }
+  {
+    NDIW_TRACE_SCOPE("send audio");
+    lib->NDIlib_send_send_audio_v2(pNDIInstance_.get(), &frame);
+  }
+  stats_->audioFrames.fetch_add(1, std::memory_order_relaxed);
+}
 
-    // Toggle the buffer index for the next frame
-    m_currentBufferIndex = (m_currentBufferIndex + 1) % m_frameBuffers.size();
-  } // Mutex is unlocked here
+void NDISender::flushAsync() {
+  if (!pNDIInstance_) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(m_bufferMutex);
+  lib->NDIlib_send_send_video_async_v2(pNDIInstance_.get(), nullptr);
+}
 
-  // Prepare the NDI video frame with the current buffer
-  auto &buffer = m_frameBuffers[bufferIndex];
-  NDIlib_video_frame_v2_t NDI_video_frame;
-  NDI_video_frame.xres = buffer.width;
-  NDI_video_frame.yres = buffer.height;
-  NDI_video_frame.FourCC = videoType;
-  NDI_video_frame.p_data = buffer.data.data();
-  NDI_video_frame.line_stride_in_bytes = buffer.stride;
-  // Send the frame asynchronously
-  { lib->NDIlib_send_send_video_async_v2(pNDIInstance_, &NDI_video_frame); }
+void NDISender::asyncFeedFrame(Image &image,
+                               NDIlib_FourCC_video_type_e videoType) {
+  sendBufferedFrameAsync(image, videoType, nullptr);
 }
 
 void NDISender::asyncFeedFrame(Image &image,
                                NDIlib_FourCC_video_type_e videoType,
                                std::string metadata) {
+  sendBufferedFrameAsync(image, videoType, &metadata);
+}
+
+void NDISender::asyncFeedFrame(Image &image,
+                               NDIlib_FourCC_video_type_e videoType,
+                               const MetadataContainer &metadata) {
+  std::string encodedMetadata = Metadata::encode(metadata);
+  sendBufferedFrameAsync(image, videoType, &encodedMetadata);
+}
 
+void NDISender::sendBufferedFrameAsync(Image &image,
+                                       NDIlib_FourCC_video_type_e videoType,
+                                       const std::string *metadata) {
   if (!pNDIInstance_) {
-    Logger::log_error("Pndi send not initialized");
+    NDIW_LOG_ERROR_EVERY(1000, "Pndi send not initialized");
     return;
   }
 
-  int bufferIndex;
-  {
-    // Lock the buffer for writing
-    std::lock_guard<std::mutex> lock(m_bufferMutex);
-
-    // Swap the image with the current buffer to avoid deep copy
-    std::swap(m_frameBuffers[m_currentBufferIndex], image);
+  // The lock is held over the send so the buffer we write to can not be the
+  // one the sdk is still reading, the sdk lets go of the previous buffer when
+  // the next async send is made
+  std::lock_guard<std::mutex> lock(m_bufferMutex);
 
-    // Use the current buffer index for NDI frame preparation
-    bufferIndex = m_currentBufferIndex;
+  // Swap the image with the current buffer to avoid deep copy
+  size_t bufferIndex = m_currentBufferIndex;
+  std::swap(m_frameBuffers[bufferIndex], image);
 
-    // Toggle the buffer index for the next frame
-    m_currentBufferIndex = (m_currentBufferIndex + 1) % m_frameBuffers.size();
-  } // Mutex is unlocked here
+  // Toggle the buffer index for the next frame
+  m_currentBufferIndex = (m_currentBufferIndex + 1) % m_frameBuffers.size();
 
   // Prepare the NDI video frame with the current buffer
   auto &buffer = m_frameBuffers[bufferIndex];
@@ -148,15 +192,23 @@ void NDISender::asyncFeedFrame(Image &image,
   NDI_video_frame.p_data = buffer.data.data();
   NDI_video_frame.line_stride_in_bytes = buffer.stride;
 
-  NDI_video_frame.p_metadata = strdup(metadata.c_str());
+  if (metadata) {
+    // assign keeps the capacity of the string so a running sender stops
+    // allocating once the buffers have grown to the metadata size
+    auto &metadataBuffer = m_metadataBuffers[bufferIndex];
+    metadataBuffer.assign(*metadata);
+    NDI_video_frame.p_metadata = metadataBuffer.c_str();
+  }
 
   // Send the frame asynchronously
-  { lib->NDIlib_send_send_video_async_v2(pNDIInstance_, &NDI_video_frame); }
+  NDIW_TRACE_SCOPE("send video async");
+  lib->NDIlib_send_send_video_async_v2(pNDIInstance_.get(), &NDI_video_frame);
+  stats_->videoFrames.fetch_add(1, std::memory_order_relaxed);
 }
 
 void NDISender::feedAudioAsync(Audio &audio) {
   if (!pNDIInstance_) {
-    Logger::log_error("Pndi send not initialized for audio");
+    NDIW_LOG_ERROR_EVERY(1000, "Pndi send not initialized for audio");
     return;
   }
 
@@ -171,7 +223,11 @@ void NDISender::feedAudioAsync(Audio &audio) {
     NDI_audio_frame.channel_stride_in_bytes =
         NDI_audio_frame.no_samples * sizeof(float);
 
-    { lib->NDIlib_send_send_audio_v2(pNDIInstance_, &NDI_audio_frame); }
+    {
+      NDIW_TRACE_SCOPE("send audio");
+      lib->NDIlib_send_send_audio_v2(pNDIInstance_.get(), &NDI_audio_frame);
+    }
+    stats_->audioFrames.fetch_add(1, std::memory_order_relaxed);
   });
 
   // Detach the thread to allow it to run independently
@@ -180,7 +236,7 @@ void NDISender::feedAudioAsync(Audio &audio) {
 
 void NDISender::feedAudio(Audio16 &audio) {
   if (!pNDIInstance_) {
-    Logger::log_error("Pndi send not initialized for audio");
+    NDIW_LOG_ERROR_EVERY(1000, "Pndi send not initialized for audio");
     return;
   }
 
@@ -191,13 +247,15 @@ void NDISender::feedAudio(Audio16 &audio) {
   NDI_audio_frame.p_data = audio.data.data();
 
   {
-    lib->NDIlib_util_send_send_audio_interleaved_16s(pNDIInstance_,
+    NDIW_TRACE_SCOPE("send audio");
+    lib->NDIlib_util_send_send_audio_interleaved_16s(pNDIInstance_.get(),
                                                      &NDI_audio_frame);
   }
+  stats_->audioFrames.fetch_add(1, std::memory_order_relaxed);
 }
 void NDISender::feedAudioAsync(Audio16 &audio) {
   if (!pNDIInstance_) {
-    Logger::log_error("Pndi send not initialized for audio");
+    NDIW_LOG_ERROR_EVERY(1000, "Pndi send not initialized for audio");
     return;
   }
 
@@ -209,9 +267,11 @@ void NDISender::feedAudioAsync(Audio16 &audio) {
     NDI_audio_frame.no_samples = audio.noSamples;
     NDI_audio_frame.p_data = audio.data.data();
     {
-      lib->NDIlib_util_send_send_audio_interleaved_16s(pNDIInstance_,
+      NDIW_TRACE_SCOPE("send audio");
+      lib->NDIlib_util_send_send_audio_interleaved_16s(pNDIInstance_.get(),
                                                        &NDI_audio_frame);
     }
+    stats_->audioFrames.fetch_add(1, std::memory_order_relaxed);
   });
 
   // Detach the thread to allow it to run independently
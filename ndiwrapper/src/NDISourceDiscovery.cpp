@@ -0,0 +1,147 @@
+#include "NDISourceDiscovery.hpp"
+
+#include "NDIWLog.hpp"
+#include "NDILibraryManager.hpp"
+
+std::mutex NDISourceDiscovery::registryMutex_;
+std::map<std::string, std::weak_ptr<NDISourceDiscovery>>
+    NDISourceDiscovery::registry_;
+
+std::shared_ptr<NDISourceDiscovery>
+NDISourceDiscovery::acquire(const std::string &groups, bool findGroup) {
+  // the key has to tell apart finding the group "" and not finding a group
+  std::string key = findGroup ? "group:" + groups : "nogroup";
+
+  std::lock_guard<std::mutex> lock(registryMutex_);
+  auto existing = registry_[key].lock();
+  if (existing) {
+    return existing;
+  }
+
+  const NDIlib_v6 *lib = NDILibraryManager::Acquire();
+  if (!lib) {
+    return nullptr;
+  }
+  std::shared_ptr<NDISourceDiscovery> discovery(
+      new NDISourceDiscovery(lib, groups, findGroup));
+  if (!discovery->pNDIFind_) {
+    return nullptr;
+  }
+  registry_[key] = discovery;
+  return discovery;
+}
+
+NDISourceDiscovery::NDISourceDiscovery(const NDIlib_v6 *lib,
+                                       const std::string &groups,
+                                       bool findGroup)
+    : lib_(lib), groups_(groups), findGroup_(findGroup), pNDIFind_(nullptr),
+      running_(false), sources_(std::make_shared<const NDISourceMap>()) {
+  NDIlib_find_create_t NDI_find_create_desc; /* Use defaults */
+  if (findGroup_) {
+    NDI_find_create_desc.p_groups = groups_.c_str();
+  }
+  pNDIFind_ = lib_->NDIlib_find_create_v2(&NDI_find_create_desc);
+  if (!pNDIFind_) {
+    NDIW_LOG_ERROR("Failed to create NDI finder instance.");
+    return;
+  }
+  running_ = true;
+  thread_ = std::thread(&NDISourceDiscovery::run, this);
+}
+
+NDISourceDiscovery::~NDISourceDiscovery() {
+  running_ = false;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (pNDIFind_) {
+    lib_->NDIlib_find_destroy(pNDIFind_);
+  }
+  NDILibraryManager::Release();
+}
+
+std::shared_ptr<const NDISourceMap> NDISourceDiscovery::snapshot() const {
+  return std::atomic_load(&sources_);
+}
+
+size_t NDISourceDiscovery::subscribe(Listener listener) {
+  std::lock_guard<std::mutex> lock(listenerMutex_);
+  // the snapshot only changes while listenerMutex_ is held, so the listener
+  // sees every source exactly once
+  auto sources = snapshot();
+  if (!sources->empty()) {
+    listener(diff({}, *sources));
+  }
+  size_t id = nextListenerId_++;
+  listeners_[id] = std::move(listener);
+  return id;
+}
+
+void NDISourceDiscovery::unsubscribe(size_t id) {
+  std::lock_guard<std::mutex> lock(listenerMutex_);
+  listeners_.erase(id);
+}
+
+void NDISourceDiscovery::run() {
+  try {
+    while (running_.load()) {
+      // Wait up till 1 second for sources to be added or removed, returns
+      // false if nothing changed
+      if (!lib_->NDIlib_find_wait_for_sources(pNDIFind_, 1000)) {
+        continue;
+      }
+      uint32_t no_sources = 0;
+      const NDIlib_source_t *p_sources =
+          lib_->NDIlib_find_get_current_sources(pNDIFind_, &no_sources);
+
+      auto currentSources = std::make_shared<NDISourceMap>();
+      for (uint32_t i = 0; i < no_sources; i++) {
+        (*currentSources)[p_sources[i].p_ndi_name] =
+            p_sources[i].p_url_address ? p_sources[i].p_url_address : "";
+      }
+
+      std::lock_guard<std::mutex> lock(listenerMutex_);
+      auto events = diff(*snapshot(), *currentSources);
+      if (events.empty()) {
+        continue;
+      }
+      NDIW_LOG_DEBUG("sources changed, total sources found", no_sources);
+      std::atomic_store(&sources_,
+                        std::shared_ptr<const NDISourceMap>(currentSources));
+      for (const auto &[id, listener] : listeners_) {
+        listener(events);
+      }
+    }
+  } catch (const std::exception &e) {
+    NDIW_LOG_ERROR("failed to get sources", e.what());
+  }
+}
+
+std::vector<NDISourceEvent>
+NDISourceDiscovery::diff(const NDISourceMap &previous,
+                         const NDISourceMap &current) {
+  std::vector<NDISourceEvent> events;
+  // both maps are sorted by name so walk them side by side
+  auto prevIt = previous.begin();
+  auto currIt = current.begin();
+  while (prevIt != previous.end() || currIt != current.end()) {
+    if (currIt == current.end() ||
+        (prevIt != previous.end() && prevIt->first < currIt->first)) {
+      events.push_back(
+          {NDISourceEventType::Removed, prevIt->first, prevIt->second});
+      ++prevIt;
+    } else if (prevIt == previous.end() || currIt->first < prevIt->first) {
+      events.push_back(
+          {NDISourceEventType::Added, currIt->first, currIt->second});
+      ++currIt;
+    } else {
+      if (prevIt->second != currIt->second) {
+        events.push_back(
+            {NDISourceEventType::Changed, currIt->first, currIt->second});
+      }
+      ++prevIt;
+      ++currIt;
+    }
+  }
+  return events;
+}
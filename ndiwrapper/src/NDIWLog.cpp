@@ -0,0 +1,13 @@
+#include "NDIWLog.hpp"
+
+namespace NDIWLog {
+namespace {
+std::atomic<Level> runtimeLevel{Level::Info};
+}
+
+void setLevel(Level value) {
+  runtimeLevel.store(value, std::memory_order_relaxed);
+}
+
+Level level() { return runtimeLevel.load(std::memory_order_relaxed); }
+} // namespace NDIWLog
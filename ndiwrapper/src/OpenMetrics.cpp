@@ -0,0 +1,164 @@
+#include "OpenMetrics.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+
+namespace OpenMetrics {
+namespace {
+constexpr const char *kPrefix = "ndiwrapper_";
+
+using CountFunc = std::function<uint64_t(const EndpointStatsSnapshot &)>;
+using HistogramFunc = std::function<const LatencyHistogram::Snapshot &(
+    const EndpointStatsSnapshot &)>;
+
+std::string escapeLabel(const std::string &value) {
+  std::string escaped;
+  escaped.reserve(value.size());
+  for (char c : value) {
+    switch (c) {
+    case '\\':
+      escaped += "\\\\";
+      break;
+    case '"':
+      escaped += "\\\"";
+      break;
+    case '\n':
+      escaped += "\\n";
+      break;
+    default:
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+std::string formatDouble(double value) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+  return buffer;
+}
+
+std::string labels(const StatsRegistry::Entry &entry) {
+  return "endpoint=\"" + escapeLabel(entry.kind) + "\",id=\"" +
+         std::to_string(entry.id) + "\",name=\"" + escapeLabel(entry.name) +
+         "\"";
+}
+
+void family(std::string &out, const std::string &name, const char *type,
+            const char *help) {
+  out += "# TYPE ";
+  out += kPrefix + name;
+  out += ' ';
+  out += type;
+  out += "\n# HELP ";
+  out += kPrefix + name;
+  out += ' ';
+  out += help;
+  out += '\n';
+}
+
+void counter(std::string &out, const std::vector<StatsRegistry::Entry> &entries,
+             const std::string &name, const char *help, const CountFunc &get) {
+  family(out, name, "counter", help);
+  for (const auto &entry : entries) {
+    out += kPrefix + name + "_total{" + labels(entry) + "} " +
+           std::to_string(get(entry.stats)) + '\n';
+  }
+}
+
+void gauge(std::string &out, const std::vector<StatsRegistry::Entry> &entries,
+           const std::string &name, const char *help, const CountFunc &get) {
+  family(out, name, "gauge", help);
+  for (const auto &entry : entries) {
+    out += kPrefix + name + '{' + labels(entry) + "} " +
+           std::to_string(get(entry.stats)) + '\n';
+  }
+}
+
+void histogram(std::string &out,
+               const std::vector<StatsRegistry::Entry> &entries,
+               const std::string &name, const char *help,
+               const HistogramFunc &get) {
+  family(out, name, "histogram", help);
+  for (const auto &entry : entries) {
+    const auto &histogram = get(entry.stats);
+    std::string entryLabels = labels(entry);
+    uint64_t cumulative = 0;
+    // the last bucket also holds everything longer so it is only +Inf
+    for (size_t i = 0; i + 1 < LatencyHistogram::kBuckets; i++) {
+      cumulative += histogram.buckets[i];
+      double le =
+          LatencyHistogram::Snapshot::bucketUpperBoundUs(i) / 1000000.0;
+      out += kPrefix + name + "_bucket{" + entryLabels + ",le=\"" +
+             formatDouble(le) + "\"} " + std::to_string(cumulative) + '\n';
+    }
+    cumulative += histogram.buckets[LatencyHistogram::kBuckets - 1];
+    out += kPrefix + name + "_bucket{" + entryLabels + ",le=\"+Inf\"} " +
+           std::to_string(cumulative) + '\n';
+    out += kPrefix + name + "_count{" + entryLabels + "} " +
+           std::to_string(cumulative) + '\n';
+    out += kPrefix + name + "_sum{" + entryLabels + "} " +
+           formatDouble(histogram.sumUs / 1000000.0) + '\n';
+  }
+}
+} // namespace
+
+std::string render(const std::vector<StatsRegistry::Entry> &entries) {
+  std::string out;
+  counter(out, entries, "video_frames", "Video frames received or sent.",
+          [](const EndpointStatsSnapshot &s) { return s.videoFrames; });
+  counter(out, entries, "audio_frames", "Audio frames received or sent.",
+          [](const EndpointStatsSnapshot &s) { return s.audioFrames; });
+  counter(out, entries, "metadata_frames", "Metadata frames received.",
+          [](const EndpointStatsSnapshot &s) { return s.metadataFrames; });
+  counter(out, entries, "dropped_video_frames",
+          "Video frames the NDI receiver dropped on the current connection.",
+          [](const EndpointStatsSnapshot &s) { return s.droppedVideoFrames; });
+  counter(out, entries, "dropped_audio_frames",
+          "Audio frames the NDI receiver dropped on the current connection.",
+          [](const EndpointStatsSnapshot &s) { return s.droppedAudioFrames; });
+  counter(
+      out, entries, "dropped_metadata_frames",
+      "Metadata frames the NDI receiver dropped on the current connection.",
+      [](const EndpointStatsSnapshot &s) { return s.droppedMetadataFrames; });
+  gauge(out, entries, "queued_video_frames",
+        "Video frames waiting in the NDI receiver queue.",
+        [](const EndpointStatsSnapshot &s) { return s.queuedVideoFrames; });
+  gauge(out, entries, "queued_audio_frames",
+        "Audio frames waiting in the NDI receiver queue.",
+        [](const EndpointStatsSnapshot &s) { return s.queuedAudioFrames; });
+  gauge(out, entries, "queued_metadata_frames",
+        "Metadata frames waiting in the NDI receiver queue.",
+        [](const EndpointStatsSnapshot &s) { return s.queuedMetadataFrames; });
+  gauge(out, entries, "callback_queue_depth",
+        "Callbacks waiting for a thread in the callback pool.",
+        [](const EndpointStatsSnapshot &s) {
+          return static_cast<uint64_t>(s.callbackQueueDepth);
+        });
+  histogram(out, entries, "callback_latency_seconds",
+            "Time from capturing a frame to its callback starting.",
+            [](const EndpointStatsSnapshot &s)
+                -> const LatencyHistogram::Snapshot & {
+              return s.callbackLatency;
+            });
+  histogram(out, entries, "copy_seconds",
+            "Time spent copying frames out of NDI.",
+            [](const EndpointStatsSnapshot &s)
+                -> const LatencyHistogram::Snapshot & { return s.copyTime; });
+  histogram(out, entries, "scale_seconds",
+            "Time spent scaling frames for the scaled frame callbacks.",
+            [](const EndpointStatsSnapshot &s)
+                -> const LatencyHistogram::Snapshot & { return s.scaleTime; });
+  histogram(out, entries, "metadata_decode_seconds",
+            "Time spent decoding metadata.",
+            [](const EndpointStatsSnapshot &s)
+                -> const LatencyHistogram::Snapshot & {
+              return s.metadataDecodeTime;
+            });
+  out += "# EOF\n";
+  return out;
+}
+
+std::string render() { return render(StatsRegistry::collect()); }
+} // namespace OpenMetrics
@@ -0,0 +1,28 @@
+#include "StatsRegistry.hpp"
+
+std::mutex StatsRegistry::mutex_;
+std::map<size_t, StatsRegistry::Endpoint> StatsRegistry::endpoints_;
+size_t StatsRegistry::nextId_ = 0;
+
+size_t StatsRegistry::add(const std::string &kind, NameFunc name,
+                          StatsFunc stats) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t id = nextId_++;
+  endpoints_[id] = {kind, std::move(name), std::move(stats)};
+  return id;
+}
+
+void StatsRegistry::remove(size_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  endpoints_.erase(id);
+}
+
+std::vector<StatsRegistry::Entry> StatsRegistry::collect() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<Entry> entries;
+  entries.reserve(endpoints_.size());
+  for (const auto &[id, endpoint] : endpoints_) {
+    entries.push_back({id, endpoint.kind, endpoint.name(), endpoint.stats()});
+  }
+  return entries;
+}
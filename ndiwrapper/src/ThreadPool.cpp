@@ -28,6 +28,11 @@ void ThreadPool::enqueue(std::function<void()> job) {
     cv_.notify_one();
 }
 
+size_t ThreadPool::queueSize() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return jobs_.size();
+}
+
 // The worker function to run in each thread
 void ThreadPool::worker() {
     while (true) {
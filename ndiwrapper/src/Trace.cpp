@@ -0,0 +1,191 @@
+#include "Trace.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Trace {
+namespace {
+/**
+ * @brief one event, every field is atomic so the exporter can read while the
+ * owning thread writes, seq tells if the fields belong together
+ * @details seq is odd while the slot is being written and 2 * (index + 1)
+ * once the event with that index is complete
+ */
+struct Slot {
+  std::atomic<uint64_t> seq{0};
+  std::atomic<const char *> name{nullptr};
+  std::atomic<const char *> category{nullptr};
+  std::atomic<int64_t> start{0};
+  std::atomic<int64_t> end{0};
+};
+
+struct ThreadRing {
+  explicit ThreadRing(uint32_t id) : threadId(id) {}
+
+  const uint32_t threadId;
+  std::atomic<uint64_t> head{0}; // index of the next event
+  std::array<Slot, kEventsPerThread> slots;
+};
+
+std::atomic<bool> enabled{true};
+
+std::mutex registryMutex;
+// the rings outlive their threads so the events of finished threads can
+// still be exported
+std::vector<std::shared_ptr<ThreadRing>> rings;
+// rings of finished threads, a new thread takes one of these before making a
+// new ring so threads that come and go do not add rings without end
+std::vector<std::shared_ptr<ThreadRing>> freeRings;
+
+// set when the ring of the thread has been given back, a trivial type so it
+// can still be read while the other thread locals are destroyed
+thread_local bool ringReleased = false;
+
+std::shared_ptr<ThreadRing> acquireRing() {
+  std::lock_guard<std::mutex> lock(registryMutex);
+  if (!freeRings.empty()) {
+    // keeps the old events and thread id until they are overwritten
+    auto ring = std::move(freeRings.back());
+    freeRings.pop_back();
+    return ring;
+  }
+  auto created =
+      std::make_shared<ThreadRing>(static_cast<uint32_t>(rings.size() + 1));
+  rings.push_back(created);
+  return created;
+}
+
+/**
+ * @brief gives the ring back when the thread exits
+ */
+struct RingOwner {
+  std::shared_ptr<ThreadRing> ring = acquireRing();
+  ~RingOwner() {
+    ringReleased = true;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    freeRings.push_back(std::move(ring));
+  }
+};
+
+/**
+ * @returns the ring of the calling thread or nullptr if the thread is exiting
+ */
+ThreadRing *threadRing() {
+  if (ringReleased) {
+    return nullptr;
+  }
+  thread_local RingOwner owner;
+  return owner.ring.get();
+}
+
+void appendEscaped(std::string &out, const char *text) {
+  for (; text && *text; text++) {
+    char c = *text;
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) >= 0x20) {
+      out += c;
+    }
+  }
+}
+} // namespace
+
+int64_t now() {
+  static const auto epoch = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+void record(const char *name, const char *category, int64_t startNs,
+            int64_t endNs) {
+  ThreadRing *ring = threadRing();
+  if (!ring) {
+    return;
+  }
+  uint64_t index = ring->head.load(std::memory_order_relaxed);
+  Slot &slot = ring->slots[index % kEventsPerThread];
+  slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.category.store(category, std::memory_order_relaxed);
+  slot.start.store(startNs, std::memory_order_relaxed);
+  slot.end.store(endNs, std::memory_order_relaxed);
+  slot.seq.store(2 * (index + 1), std::memory_order_release);
+  ring->head.store(index + 1, std::memory_order_release);
+}
+
+void setEnabled(bool value) { enabled.store(value, std::memory_order_relaxed); }
+
+bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+void clear() {
+  std::lock_guard<std::mutex> lock(registryMutex);
+  for (auto &ring : rings) {
+    for (auto &slot : ring->slots) {
+      // an event from before the clear can never match this again
+      slot.seq.store(1, std::memory_order_relaxed);
+    }
+  }
+}
+
+std::string chromeTraceJson() {
+  std::vector<std::shared_ptr<ThreadRing>> snapshot;
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    snapshot = rings;
+  }
+
+  std::string out = "{\"traceEvents\":[";
+  bool first = true;
+  for (const auto &ring : snapshot) {
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t begin = head > kEventsPerThread ? head - kEventsPerThread : 0;
+    for (uint64_t index = begin; index < head; index++) {
+      const Slot &slot = ring->slots[index % kEventsPerThread];
+      uint64_t seq = slot.seq.load(std::memory_order_acquire);
+      if (seq != 2 * (index + 1)) {
+        continue; // overwritten or being written
+      }
+      const char *name = slot.name.load(std::memory_order_relaxed);
+      const char *category = slot.category.load(std::memory_order_relaxed);
+      int64_t start = slot.start.load(std::memory_order_relaxed);
+      int64_t end = slot.end.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.seq.load(std::memory_order_relaxed) != seq) {
+        continue;
+      }
+
+      out += first ? "" : ",";
+      first = false;
+      out += "{\"name\":\"";
+      appendEscaped(out, name);
+      out += "\",\"cat\":\"";
+      appendEscaped(out, category);
+      // chrome wants microseconds, the fraction keeps the nanoseconds
+      out += "\",\"ph\":\"X\",\"ts\":" + std::to_string(start / 1000) + "." +
+             std::to_string(1000 + start % 1000).substr(1) +
+             ",\"dur\":" + std::to_string((end - start) / 1000) + "." +
+             std::to_string(1000 + (end - start) % 1000).substr(1) +
+             ",\"pid\":1,\"tid\":" + std::to_string(ring->threadId) + "}";
+    }
+  }
+  out += "],\"displayTimeUnit\":\"ns\"}";
+  return out;
+}
+
+bool writeChromeTrace(const std::string &path) {
+  std::ofstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  file << chromeTraceJson();
+  return static_cast<bool>(file);
+}
+} // namespace Trace
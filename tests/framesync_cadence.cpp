@@ -0,0 +1,154 @@
+#include "NDIReceiver.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief checks the framesync mode against the stand-in runtime: the frames
+ * come at the output rate, the audio of each frame has the sample count of
+ * the video period and the timestamps of the source are kept
+ * @details usage: NDIFrameSyncCadence <path to the stand-in library>
+ */
+namespace {
+// the stand-in frame size, the receiver sends 400x400 blanks before connecting
+constexpr int kStandinWidth = 64;
+
+struct Received {
+  std::mutex mutex;
+  std::vector<int64_t> videoTimestamps; // ns
+  std::vector<int> audioSamples;
+  int audioChannels = 0;
+  int audioRate = 0;
+};
+
+bool check(bool ok, const std::string &what) {
+  std::cout << (ok ? "ok   " : "FAIL ") << what << std::endl;
+  return ok;
+}
+
+bool runAt(int frameRateN, int frameRateD) {
+  FrameSyncSettings settings;
+  settings.frameRateN = frameRateN;
+  settings.frameRateD = frameRateD;
+  settings.sampleRate = 48000;
+  settings.channels = 2;
+  const double period = double(frameRateD) / frameRateN;
+  const double samplesPerFrame = settings.sampleRate * period;
+  std::cout << "framesync at " << frameRateN << "/" << frameRateD << std::endl;
+
+  Received received;
+  NDIReceiver receiver("", false, true);
+  receiver.setFrameSyncSettings(settings);
+  receiver.addFrameCallback([&](Image image) {
+    if (image.width != kStandinWidth) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(received.mutex);
+    received.videoTimestamps.push_back(image.timestamp);
+  });
+  receiver.addAudioCallback([&](Audio audio) {
+    std::lock_guard<std::mutex> lock(received.mutex);
+    received.audioSamples.push_back(audio.noSamples);
+    received.audioChannels = audio.channels;
+    received.audioRate = audio.sampleRate;
+  });
+  receiver.start();
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  bool connected = false;
+  while (!connected && std::chrono::steady_clock::now() < deadline) {
+    auto sources = receiver.getCurrentSources();
+    if (!sources.empty()) {
+      connected = receiver.setOutput(sources.front());
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+  if (!check(connected, "connected to the stand-in source")) {
+    return false;
+  }
+  std::this_thread::sleep_for(std::chrono::seconds(3));
+  receiver.stop();
+
+  std::lock_guard<std::mutex> lock(received.mutex);
+  // the first frames go while the clock settles
+  std::vector<int64_t> timestamps(
+      received.videoTimestamps.begin() +
+          std::min<size_t>(5, received.videoTimestamps.size()),
+      received.videoTimestamps.end());
+  size_t expectedFrames = static_cast<size_t>(2.5 / period);
+  bool ok = check(timestamps.size() >= expectedFrames,
+                  "at least " + std::to_string(expectedFrames) +
+                      " frames, got " + std::to_string(timestamps.size()));
+  if (timestamps.size() < 2) {
+    return false;
+  }
+
+  // the callbacks run on the pool so sort by the capture time
+  std::sort(timestamps.begin(), timestamps.end());
+  std::vector<double> intervals;
+  for (size_t i = 1; i < timestamps.size(); i++) {
+    intervals.push_back((timestamps[i] - timestamps[i - 1]) * 1e-9);
+  }
+  double mean = 0;
+  for (double interval : intervals) {
+    mean += interval;
+  }
+  mean /= intervals.size();
+  size_t steady = std::count_if(
+      intervals.begin(), intervals.end(),
+      [&](double interval) { return std::abs(interval - period) < 0.004; });
+  ok &= check(timestamps.front() > 0, "the source timestamps are kept");
+  ok &= check(std::abs(mean - period) < period * 0.02,
+              "mean interval " + std::to_string(mean * 1e3) + " ms for " +
+                  std::to_string(period * 1e3) + " ms");
+  ok &= check(steady >= intervals.size() * 9 / 10,
+              std::to_string(steady) + " of " +
+                  std::to_string(intervals.size()) +
+                  " intervals within 4 ms of the period");
+
+  // the counts are the floor or the ceiling of the samples per frame and add
+  // up to the sample rate
+  bool counts = std::all_of(
+      received.audioSamples.begin(), received.audioSamples.end(),
+      [&](int samples) {
+        return samples == int(std::floor(samplesPerFrame)) ||
+               samples == int(std::ceil(samplesPerFrame));
+      });
+  ok &= check(!received.audioSamples.empty() && counts,
+              "every audio frame has " + std::to_string(samplesPerFrame) +
+                  " samples rounded");
+  double total = 0;
+  for (int samples : received.audioSamples) {
+    total += samples;
+  }
+  ok &= check(std::abs(total - received.audioSamples.size() * samplesPerFrame) <
+                  received.audioSamples.size() * 0.01 + 2,
+              "the audio adds up to the sample rate");
+  ok &= check(received.audioRate == settings.sampleRate &&
+                  received.audioChannels == settings.channels,
+              "the audio has the output sample rate and channels");
+  return ok;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "usage: NDIFrameSyncCadence <stand-in library>" << std::endl;
+    return 1;
+  }
+#ifdef _WIN32
+  _putenv_s("NDIWRAPPER_NDI_LIBRARY", argv[1]);
+#else
+  setenv("NDIWRAPPER_NDI_LIBRARY", argv[1], 1);
+#endif
+  bool ok = runAt(50, 1);
+  ok &= runAt(30000, 1001);
+  return ok ? 0 : 1;
+}
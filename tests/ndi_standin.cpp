@@ -0,0 +1,634 @@
+#include <Processing.NDI.Lib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief a stand-in for the ndi runtime, loaded with NDIWRAPPER_NDI_LIBRARY
+ * @details the senders are looped back in process: every sender shows up as
+ * the source "STANDIN (name)" and its frames are copied to the receivers
+ * connected to it, stamped with the time they were sent like the sdk does.
+ * Metadata goes both ways. The source "STANDIN (cadence)" is always there
+ * and the framesync gives a test pattern right away whatever the source, so
+ * the timing of the synced frames is the timing of the receiver. Groups are
+ * ignored, every receiver sees every sender
+ */
+namespace {
+constexpr int kWidth = 64;
+constexpr int kHeight = 36;
+// the waits are cut short so the receiver threads stop quickly
+constexpr uint32_t kMaxWaitMs = 100;
+// frames a receiver keeps before the oldest are dropped, like the sdk queue
+constexpr size_t kMaxQueued = 8;
+const char *const kHost = "STANDIN";
+
+/**
+ * @brief a frame copied out of the sender, the sdk structs point into it
+ */
+struct Frame {
+  NDIlib_video_frame_v2_t video;
+  NDIlib_audio_frame_v2_t audio;
+  NDIlib_metadata_frame_t metadata;
+  std::vector<uint8_t> data;
+  std::string metadataText;
+};
+
+using FramePtr = std::unique_ptr<Frame>;
+
+struct Receiver {
+  std::string source;
+  NDIlib_recv_bandwidth_e bandwidth = NDIlib_recv_bandwidth_highest;
+  std::condition_variable arrived;
+  std::deque<FramePtr> video;
+  std::deque<FramePtr> audio;
+  std::deque<FramePtr> metadata;
+  // captured and not freed yet, by the pointer the sdk struct hands out
+  std::map<const void *, FramePtr> held;
+  NDIlib_recv_performance_t total;
+  NDIlib_recv_performance_t dropped;
+};
+
+struct Sender {
+  std::string source; // "STANDIN (name)"
+  std::condition_variable arrived;
+  std::deque<FramePtr> metadata; // sent by the receivers
+  std::map<const void *, FramePtr> held;
+};
+
+struct Find {
+  uint64_t seenGeneration = 0;
+  std::vector<std::string> names;
+  std::vector<NDIlib_source_t> sources;
+};
+
+/**
+ * @brief everything the endpoints share, one mutex guards all of it
+ */
+struct Hub {
+  std::mutex mutex;
+  std::condition_variable sourcesChanged;
+  // bumped whenever a sender comes or goes, starts ahead of the finds so the
+  // first wait reports the sources
+  uint64_t generation = 1;
+  std::vector<Sender *> senders;
+  std::vector<Receiver *> receivers;
+};
+
+Hub &hub() {
+  static Hub instance;
+  return instance;
+}
+
+int64_t nowTicks() {
+  // ndi timestamps are in 100 ns units
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+             .count() /
+         100;
+}
+
+int64_t utcTicks() {
+  // the sdk stamps the frames it sends with the utc time in 100 ns units
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+             .count() /
+         100;
+}
+
+std::chrono::milliseconds cappedWait(uint32_t timeoutMs) {
+  return std::chrono::milliseconds(std::min(timeoutMs, kMaxWaitMs));
+}
+
+template <typename Handle> Handle newHandle() {
+  return reinterpret_cast<Handle>(new int(0));
+}
+
+template <typename Handle> void deleteHandle(Handle handle) {
+  delete reinterpret_cast<int *>(handle);
+}
+
+Receiver *asReceiver(NDIlib_recv_instance_t instance) {
+  return reinterpret_cast<Receiver *>(instance);
+}
+
+Sender *asSender(NDIlib_send_instance_t instance) {
+  return reinterpret_cast<Sender *>(instance);
+}
+
+bool carriesVideo(NDIlib_recv_bandwidth_e bandwidth) {
+  return bandwidth != NDIlib_recv_bandwidth_audio_only &&
+         bandwidth != NDIlib_recv_bandwidth_metadata_only;
+}
+
+bool carriesAudio(NDIlib_recv_bandwidth_e bandwidth) {
+  return bandwidth != NDIlib_recv_bandwidth_metadata_only;
+}
+
+size_t videoBytes(const NDIlib_video_frame_v2_t &frame) {
+  size_t stride = size_t(std::max(frame.line_stride_in_bytes, 0));
+  size_t width = size_t(std::max(frame.xres, 0));
+  size_t height = size_t(std::max(frame.yres, 0));
+  switch (frame.FourCC) {
+  case NDIlib_FourCC_video_type_NV12:
+  case NDIlib_FourCC_video_type_I420:
+  case NDIlib_FourCC_video_type_YV12:
+    return stride * height * 3 / 2;
+  case NDIlib_FourCC_video_type_UYVA:
+    return stride * height + width * height;
+  case NDIlib_FourCC_video_type_P216:
+    return stride * height * 2;
+  case NDIlib_FourCC_video_type_PA16:
+    return stride * height * 3;
+  default:
+    return stride * height;
+  }
+}
+
+void copyMetadataText(Frame &frame, const char *text) {
+  if (text) {
+    frame.metadataText = text;
+  }
+}
+
+/**
+ * @brief queues a copy for every receiver of the sender that takes it
+ * @details the caller holds the hub mutex
+ */
+void deliver(const Sender &sender, NDIlib_frame_type_e type,
+             const Frame &frame) {
+  for (Receiver *receiver : hub().receivers) {
+    if (receiver->source != sender.source) {
+      continue;
+    }
+    std::deque<FramePtr> *queue = &receiver->metadata;
+    int64_t *total = &receiver->total.metadata_frames;
+    int64_t *dropped = &receiver->dropped.metadata_frames;
+    if (type == NDIlib_frame_type_video) {
+      if (!carriesVideo(receiver->bandwidth)) {
+        continue;
+      }
+      queue = &receiver->video;
+      total = &receiver->total.video_frames;
+      dropped = &receiver->dropped.video_frames;
+    } else if (type == NDIlib_frame_type_audio) {
+      if (!carriesAudio(receiver->bandwidth)) {
+        continue;
+      }
+      queue = &receiver->audio;
+      total = &receiver->total.audio_frames;
+      dropped = &receiver->dropped.audio_frames;
+    }
+    if (queue->size() >= kMaxQueued) {
+      queue->pop_front();
+      (*dropped)++;
+    }
+    auto copy = std::make_unique<Frame>(frame);
+    if (copy->data.empty()) {
+      // every frame needs an address of its own to be freed by
+      copy->data.resize(1);
+    }
+    copy->video.p_data = copy->data.data();
+    copy->video.p_metadata =
+        copy->metadataText.empty() ? nullptr : copy->metadataText.c_str();
+    copy->audio.p_data = reinterpret_cast<float *>(copy->data.data());
+    copy->audio.p_metadata = copy->video.p_metadata;
+    copy->metadata.p_data = &copy->metadataText[0];
+    queue->push_back(std::move(copy));
+    (*total)++;
+    receiver->arrived.notify_one();
+  }
+}
+
+bool initialize() { return true; }
+void destroy() {}
+
+NDIlib_find_instance_t findCreate(const NDIlib_find_create_t *) {
+  return reinterpret_cast<NDIlib_find_instance_t>(new Find());
+}
+
+void findDestroy(NDIlib_find_instance_t instance) {
+  delete reinterpret_cast<Find *>(instance);
+}
+
+bool findWait(NDIlib_find_instance_t instance, uint32_t timeoutMs) {
+  auto find = reinterpret_cast<Find *>(instance);
+  std::unique_lock<std::mutex> lock(hub().mutex);
+  bool changed = hub().sourcesChanged.wait_for(
+      lock, cappedWait(timeoutMs),
+      [&]() { return find->seenGeneration != hub().generation; });
+  find->seenGeneration = hub().generation;
+  return changed;
+}
+
+const NDIlib_source_t *findSources(NDIlib_find_instance_t instance,
+                                   uint32_t *noSources) {
+  auto find = reinterpret_cast<Find *>(instance);
+  {
+    std::lock_guard<std::mutex> lock(hub().mutex);
+    find->names = {std::string(kHost) + " (cadence)"};
+    for (const Sender *sender : hub().senders) {
+      find->names.push_back(sender->source);
+    }
+  }
+  // the array stays valid until the next call like in the sdk
+  find->sources.assign(find->names.size(), NDIlib_source_t());
+  for (size_t i = 0; i < find->names.size(); i++) {
+    find->sources[i].p_ndi_name = find->names[i].c_str();
+    find->sources[i].p_url_address = "127.0.0.1:5961";
+  }
+  *noSources = static_cast<uint32_t>(find->sources.size());
+  return find->sources.data();
+}
+
+NDIlib_recv_instance_t recvCreate(const NDIlib_recv_create_v3_t *create) {
+  auto receiver = new Receiver();
+  if (create) {
+    if (create->source_to_connect_to.p_ndi_name) {
+      receiver->source = create->source_to_connect_to.p_ndi_name;
+    }
+    receiver->bandwidth = create->bandwidth;
+  }
+  std::lock_guard<std::mutex> lock(hub().mutex);
+  hub().receivers.push_back(receiver);
+  return reinterpret_cast<NDIlib_recv_instance_t>(receiver);
+}
+
+void recvDestroy(NDIlib_recv_instance_t instance) {
+  auto receiver = asReceiver(instance);
+  {
+    std::lock_guard<std::mutex> lock(hub().mutex);
+    auto &receivers = hub().receivers;
+    receivers.erase(std::remove(receivers.begin(), receivers.end(), receiver),
+                    receivers.end());
+  }
+  delete receiver;
+}
+
+void recvConnect(NDIlib_recv_instance_t instance,
+                 const NDIlib_source_t *source) {
+  std::lock_guard<std::mutex> lock(hub().mutex);
+  asReceiver(instance)->source =
+      source && source->p_ndi_name ? source->p_ndi_name : "";
+}
+
+NDIlib_frame_type_e recvCapture(NDIlib_recv_instance_t instance,
+                                NDIlib_video_frame_v2_t *video,
+                                NDIlib_audio_frame_v2_t *audio,
+                                NDIlib_metadata_frame_t *metadata,
+                                uint32_t timeoutMs) {
+  auto receiver = asReceiver(instance);
+  // only the kinds the caller passed a struct for are handed out
+  auto ready = [&]() {
+    return (video && !receiver->video.empty()) ||
+           (audio && !receiver->audio.empty()) ||
+           (metadata && !receiver->metadata.empty());
+  };
+  std::unique_lock<std::mutex> lock(hub().mutex);
+  if (!receiver->arrived.wait_for(lock, cappedWait(timeoutMs), ready)) {
+    return NDIlib_frame_type_none;
+  }
+  FramePtr frame;
+  NDIlib_frame_type_e type;
+  const void *key;
+  if (video && !receiver->video.empty()) {
+    frame = std::move(receiver->video.front());
+    receiver->video.pop_front();
+    *video = frame->video;
+    key = video->p_data;
+    type = NDIlib_frame_type_video;
+  } else if (audio && !receiver->audio.empty()) {
+    frame = std::move(receiver->audio.front());
+    receiver->audio.pop_front();
+    *audio = frame->audio;
+    key = audio->p_data;
+    type = NDIlib_frame_type_audio;
+  } else {
+    frame = std::move(receiver->metadata.front());
+    receiver->metadata.pop_front();
+    *metadata = frame->metadata;
+    key = metadata->p_data;
+    type = NDIlib_frame_type_metadata;
+  }
+  receiver->held[key] = std::move(frame);
+  return type;
+}
+
+void release(NDIlib_recv_instance_t instance, const void *key) {
+  std::lock_guard<std::mutex> lock(hub().mutex);
+  asReceiver(instance)->held.erase(key);
+}
+
+void recvFreeVideo(NDIlib_recv_instance_t instance,
+                   const NDIlib_video_frame_v2_t *frame) {
+  release(instance, frame->p_data);
+}
+
+void recvFreeAudio(NDIlib_recv_instance_t instance,
+                   const NDIlib_audio_frame_v2_t *frame) {
+  release(instance, frame->p_data);
+}
+
+void recvFreeMetadata(NDIlib_recv_instance_t instance,
+                      const NDIlib_metadata_frame_t *frame) {
+  release(instance, frame->p_data);
+}
+
+bool recvSendMetadata(NDIlib_recv_instance_t instance,
+                      const NDIlib_metadata_frame_t *frame) {
+  std::lock_guard<std::mutex> lock(hub().mutex);
+  for (Sender *sender : hub().senders) {
+    if (sender->source != asReceiver(instance)->source) {
+      continue;
+    }
+    auto copy = std::make_unique<Frame>();
+    copyMetadataText(*copy, frame->p_data);
+    copy->metadata = *frame;
+    copy->metadata.p_data = &copy->metadataText[0];
+    copy->metadata.length = static_cast<int>(copy->metadataText.size());
+    if (sender->metadata.size() >= kMaxQueued) {
+      sender->metadata.pop_front();
+    }
+    sender->metadata.push_back(std::move(copy));
+    sender->arrived.notify_one();
+    return true;
+  }
+  return false;
+}
+
+void recvPerformance(NDIlib_recv_instance_t instance,
+                     NDIlib_recv_performance_t *total,
+                     NDIlib_recv_performance_t *dropped) {
+  std::lock_guard<std::mutex> lock(hub().mutex);
+  if (total) {
+    *total = asReceiver(instance)->total;
+  }
+  if (dropped) {
+    *dropped = asReceiver(instance)->dropped;
+  }
+}
+
+void recvQueue(NDIlib_recv_instance_t instance, NDIlib_recv_queue_t *queue) {
+  std::lock_guard<std::mutex> lock(hub().mutex);
+  auto receiver = asReceiver(instance);
+  queue->video_frames = static_cast<int>(receiver->video.size());
+  queue->audio_frames = static_cast<int>(receiver->audio.size());
+  queue->metadata_frames = static_cast<int>(receiver->metadata.size());
+}
+
+int recvConnections(NDIlib_recv_instance_t instance) {
+  std::lock_guard<std::mutex> lock(hub().mutex);
+  const std::string &source = asReceiver(instance)->source;
+  if (source == std::string(kHost) + " (cadence)") {
+    return 1;
+  }
+  for (const Sender *sender : hub().senders) {
+    if (sender->source == source) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+NDIlib_send_instance_t sendCreate(const NDIlib_send_create_t *create) {
+  if (!create || !create->p_ndi_name) {
+    return nullptr;
+  }
+  auto sender = new Sender();
+  sender->source = std::string(kHost) + " (" + create->p_ndi_name + ")";
+  std::lock_guard<std::mutex> lock(hub().mutex);
+  hub().senders.push_back(sender);
+  hub().generation++;
+  hub().sourcesChanged.notify_all();
+  return reinterpret_cast<NDIlib_send_instance_t>(sender);
+}
+
+void sendDestroy(NDIlib_send_instance_t instance) {
+  auto sender = asSender(instance);
+  {
+    std::lock_guard<std::mutex> lock(hub().mutex);
+    auto &senders = hub().senders;
+    senders.erase(std::remove(senders.begin(), senders.end(), sender),
+                  senders.end());
+    hub().generation++;
+    hub().sourcesChanged.notify_all();
+  }
+  delete sender;
+}
+
+void sendVideo(NDIlib_send_instance_t instance,
+               const NDIlib_video_frame_v2_t *video) {
+  // the async send only flushes with nullptr, the frame is copied right away
+  // so the caller may reuse its buffer as soon as this returns
+  if (!video || !video->p_data) {
+    return;
+  }
+  Frame frame;
+  frame.video = *video;
+  frame.video.timestamp = utcTicks();
+  if (frame.video.timecode == NDIlib_send_timecode_synthesize) {
+    frame.video.timecode = frame.video.timestamp;
+  }
+  frame.data.assign(video->p_data, video->p_data + videoBytes(*video));
+  copyMetadataText(frame, video->p_metadata);
+  std::lock_guard<std::mutex> lock(hub().mutex);
+  deliver(*asSender(instance), NDIlib_frame_type_video, frame);
+}
+
+void sendAudio(NDIlib_send_instance_t instance,
+               const NDIlib_audio_frame_v2_t *audio) {
+  if (!audio || !audio->p_data || audio->no_channels <= 0) {
+    return;
+  }
+  Frame frame;
+  frame.audio = *audio;
+  frame.audio.timestamp = utcTicks();
+  if (frame.audio.timecode == NDIlib_send_timecode_synthesize) {
+    frame.audio.timecode = frame.audio.timestamp;
+  }
+  auto bytes = reinterpret_cast<const uint8_t *>(audio->p_data);
+  frame.data.assign(bytes, bytes + size_t(audio->channel_stride_in_bytes) *
+                                       audio->no_channels);
+  copyMetadataText(frame, audio->p_metadata);
+  std::lock_guard<std::mutex> lock(hub().mutex);
+  deliver(*asSender(instance), NDIlib_frame_type_audio, frame);
+}
+
+void sendAudioInterleaved16s(NDIlib_send_instance_t instance,
+                             const NDIlib_audio_frame_interleaved_16s_t *in) {
+  if (!in || !in->p_data || in->no_channels <= 0) {
+    return;
+  }
+  // planar floats like the sdk converts them to
+  std::vector<float> planar(size_t(in->no_channels) * in->no_samples);
+  for (int s = 0; s < in->no_samples; s++) {
+    for (int c = 0; c < in->no_channels; c++) {
+      planar[size_t(c) * in->no_samples + s] =
+          in->p_data[size_t(s) * in->no_channels + c] / 32768.0f;
+    }
+  }
+  NDIlib_audio_frame_v2_t audio;
+  audio.sample_rate = in->sample_rate;
+  audio.no_channels = in->no_channels;
+  audio.no_samples = in->no_samples;
+  audio.timecode = in->timecode;
+  audio.p_data = planar.data();
+  audio.channel_stride_in_bytes = in->no_samples * int(sizeof(float));
+  sendAudio(instance, &audio);
+}
+
+bool sendMetadata(NDIlib_send_instance_t instance,
+                  const NDIlib_metadata_frame_t *metadata) {
+  if (!metadata || !metadata->p_data) {
+    return false;
+  }
+  Frame frame;
+  frame.metadata = *metadata;
+  if (frame.metadata.timecode == NDIlib_send_timecode_synthesize) {
+    frame.metadata.timecode = utcTicks();
+  }
+  copyMetadataText(frame, metadata->p_data);
+  frame.metadata.length = static_cast<int>(frame.metadataText.size());
+  std::lock_guard<std::mutex> lock(hub().mutex);
+  deliver(*asSender(instance), NDIlib_frame_type_metadata, frame);
+  return true;
+}
+
+NDIlib_frame_type_e sendCapture(NDIlib_send_instance_t instance,
+                                NDIlib_metadata_frame_t *metadata,
+                                uint32_t timeoutMs) {
+  auto sender = asSender(instance);
+  std::unique_lock<std::mutex> lock(hub().mutex);
+  if (!sender->arrived.wait_for(lock, cappedWait(timeoutMs), [&]() {
+        return !sender->metadata.empty();
+      })) {
+    return NDIlib_frame_type_none;
+  }
+  FramePtr frame = std::move(sender->metadata.front());
+  sender->metadata.pop_front();
+  *metadata = frame->metadata;
+  sender->held[metadata->p_data] = std::move(frame);
+  return NDIlib_frame_type_metadata;
+}
+
+void sendFreeMetadata(NDIlib_send_instance_t instance,
+                      const NDIlib_metadata_frame_t *metadata) {
+  std::lock_guard<std::mutex> lock(hub().mutex);
+  asSender(instance)->held.erase(metadata->p_data);
+}
+
+int sendConnections(NDIlib_send_instance_t instance, uint32_t) {
+  std::lock_guard<std::mutex> lock(hub().mutex);
+  return static_cast<int>(std::count_if(
+      hub().receivers.begin(), hub().receivers.end(),
+      [&](const Receiver *receiver) {
+        return receiver->source == asSender(instance)->source;
+      }));
+}
+
+NDIlib_framesync_instance_t framesyncCreate(NDIlib_recv_instance_t) {
+  return newHandle<NDIlib_framesync_instance_t>();
+}
+
+void framesyncDestroy(NDIlib_framesync_instance_t instance) {
+  deleteHandle(instance);
+}
+
+void framesyncCaptureAudio(NDIlib_framesync_instance_t,
+                           NDIlib_audio_frame_v2_t *frame, int sampleRate,
+                           int channels, int samples) {
+  // silence of exactly the asked size, planar floats like the sdk
+  thread_local std::vector<float> buffer;
+  buffer.assign(size_t(channels) * samples, 0.0f);
+  *frame = NDIlib_audio_frame_v2_t();
+  frame->sample_rate = sampleRate;
+  frame->no_channels = channels;
+  frame->no_samples = samples;
+  frame->p_data = buffer.data();
+  frame->channel_stride_in_bytes = samples * int(sizeof(float));
+  frame->timestamp = nowTicks();
+}
+
+void framesyncFreeAudio(NDIlib_framesync_instance_t,
+                        NDIlib_audio_frame_v2_t *) {}
+
+void framesyncCaptureVideo(NDIlib_framesync_instance_t,
+                           NDIlib_video_frame_v2_t *frame,
+                           NDIlib_frame_format_type_e) {
+  static std::vector<uint8_t> pattern = []() {
+    std::vector<uint8_t> pixels(size_t(kWidth) * kHeight * 4);
+    for (size_t i = 0; i < pixels.size(); i++) {
+      pixels[i] = static_cast<uint8_t>(i);
+    }
+    return pixels;
+  }();
+  *frame = NDIlib_video_frame_v2_t();
+  frame->xres = kWidth;
+  frame->yres = kHeight;
+  frame->FourCC = NDIlib_FourCC_video_type_RGBA;
+  frame->frame_format_type = NDIlib_frame_format_type_progressive;
+  frame->p_data = pattern.data();
+  frame->line_stride_in_bytes = kWidth * 4;
+  frame->timestamp = nowTicks();
+}
+
+void framesyncFreeVideo(NDIlib_framesync_instance_t,
+                        NDIlib_video_frame_v2_t *) {}
+
+NDIlib_v6 makeTable() {
+  NDIlib_v6 table{};
+  table.initialize = initialize;
+  table.destroy = destroy;
+  table.NDIlib_find_create_v2 = findCreate;
+  table.NDIlib_find_destroy = findDestroy;
+  table.NDIlib_find_wait_for_sources = findWait;
+  table.NDIlib_find_get_current_sources = findSources;
+  table.NDIlib_recv_create_v3 = recvCreate;
+  table.NDIlib_recv_destroy = recvDestroy;
+  table.NDIlib_recv_connect = recvConnect;
+  table.NDIlib_recv_capture_v2 = recvCapture;
+  table.NDIlib_recv_free_video_v2 = recvFreeVideo;
+  table.NDIlib_recv_free_audio_v2 = recvFreeAudio;
+  table.NDIlib_recv_free_metadata = recvFreeMetadata;
+  table.NDIlib_recv_send_metadata = recvSendMetadata;
+  table.NDIlib_recv_get_performance = recvPerformance;
+  table.NDIlib_recv_get_queue = recvQueue;
+  table.NDIlib_recv_get_no_connections = recvConnections;
+  table.NDIlib_send_create = sendCreate;
+  table.NDIlib_send_destroy = sendDestroy;
+  table.NDIlib_send_send_video_v2 = sendVideo;
+  table.NDIlib_send_send_video_async_v2 = sendVideo;
+  table.NDIlib_send_send_audio_v2 = sendAudio;
+  table.NDIlib_send_send_metadata = sendMetadata;
+  table.NDIlib_send_capture = sendCapture;
+  table.NDIlib_send_free_metadata = sendFreeMetadata;
+  table.NDIlib_send_get_no_connections = sendConnections;
+  table.NDIlib_util_send_send_audio_interleaved_16s = sendAudioInterleaved16s;
+  table.NDIlib_framesync_create = framesyncCreate;
+  table.NDIlib_framesync_destroy = framesyncDestroy;
+  table.NDIlib_framesync_capture_audio = framesyncCaptureAudio;
+  table.NDIlib_framesync_free_audio = framesyncFreeAudio;
+  table.NDIlib_framesync_capture_video = framesyncCaptureVideo;
+  table.NDIlib_framesync_free_video = framesyncFreeVideo;
+  return table;
+}
+} // namespace
+
+#ifdef _WIN32
+#define NDI_STANDIN_EXPORT __declspec(dllexport)
+#else
+#define NDI_STANDIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+extern "C" NDI_STANDIN_EXPORT const NDIlib_v6 *NDIlib_v6_load(void) {
+  static const NDIlib_v6 table = makeTable();
+  return &table;
+}
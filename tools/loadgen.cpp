@@ -0,0 +1,810 @@
+#include "AudioConversion.hpp"
+#include "EndpointStats.hpp"
+#include "FrameRecorder.hpp"
+#include "NDIEndpointFactory.hpp"
+#include "NDILibraryManager.hpp"
+#include "NDIReceiver.hpp"
+#include "NDISender.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <time.h>
+
+/**
+ * @brief headless load generator, runs N senders and M receivers for a while
+ * and prints the throughput, the cpu use and the latency from the send to the
+ * frame callback
+ * @details the receivers connect to the senders round robin. The latency is
+ * taken from the timestamp the sdk puts on the frames when they are sent so it
+ * is only right when both ends run on the same machine. Give --library to run
+ * against a stand-in runtime instead of the installed one, such as the
+ * loopback in tests/ndi_standin.cpp. Exits with 1 if a receiver finds no
+ * sender or no video arrives at all. With --connect the receivers take the
+ * sources whose name contains the pattern instead, so the two sides can run
+ * in separate processes and the cpu of each is measured on its own, eg.
+ * "--receivers 0" in one and "--senders 0 --connect ndiw-loadgen-" in the
+ * other. --switch-interval moves every receiver to the next source of its
+ * senders that often and prints how long the setOutput calls took, warm
+ * switches to standby receivers by default or cold ones with --switch-mode
+ * cold. The startup line tells how long loading the runtime took and how
+ * long the endpoints took on the factory threads against making the same
+ * number one after another. --bench audio
+ * times the audio conversion kernels against plain loops instead, with the
+ * frame size of --audio and --fps
+ */
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  int senders = 1;
+  int receivers = 1;
+  int width = 1920;
+  int height = 1080;
+  NDIlib_FourCC_video_type_e fourCC = NDIlib_FourCC_video_type_UYVY;
+  int frameRateN = 30000;
+  int frameRateD = 1001;
+  int sampleRate = 48000;
+  int channels = 2; // 0 sends no audio
+  double metadataRate = 0;
+  double duration = 10;
+  std::string group = "ndiw-loadgen";
+  std::string library;
+  std::string connect; // receivers take the sources containing this
+  double switchInterval = 0; // seconds, 0 does not switch
+  bool switchWarm = true;
+  std::string bench;   // "audio" runs the kernel benchmark and exits
+};
+
+struct SenderResult {
+  uint64_t videoFrames = 0;
+  uint64_t audioFrames = 0;
+  uint64_t metadataFrames = 0;
+  uint64_t bytes = 0;
+  uint64_t lateFrames = 0; // sent after their deadline had passed
+  double cpuSeconds = 0;
+};
+
+struct ReceiverCounters {
+  std::atomic<uint64_t> videoFrames{0};
+  std::atomic<uint64_t> audioFrames{0};
+  std::atomic<uint64_t> metadataFrames{0};
+  std::atomic<uint64_t> bytes{0};
+};
+
+const std::map<std::string, NDIlib_FourCC_video_type_e> kFourCCs = {
+    {"UYVY", NDIlib_FourCC_video_type_UYVY},
+    {"UYVA", NDIlib_FourCC_video_type_UYVA},
+    {"P216", NDIlib_FourCC_video_type_P216},
+    {"NV12", NDIlib_FourCC_video_type_NV12},
+    {"I420", NDIlib_FourCC_video_type_I420},
+    {"BGRA", NDIlib_FourCC_video_type_BGRA},
+    {"BGRX", NDIlib_FourCC_video_type_BGRX},
+    {"RGBA", NDIlib_FourCC_video_type_RGBA},
+    {"RGBX", NDIlib_FourCC_video_type_RGBX},
+};
+
+void printUsage() {
+  std::cerr
+      << "usage: NDILoadGen [--senders n] [--receivers m] [--size WxH]\n"
+         "  [--fourcc UYVY|UYVA|P216|NV12|I420|BGRA|BGRX|RGBA|RGBX]\n"
+         "  [--fps n or n/d] [--audio rate:channels, channels 0 for none]\n"
+         "  [--metadata-rate hz] [--duration s] [--group name]\n"
+         "  [--library path to the runtime or a stand-in]\n"
+         "  [--connect pattern, receivers take the sources containing it\n"
+         "   instead of the senders of this process]\n"
+         "  [--switch-interval s, moves the receivers to the next source]\n"
+         "  [--switch-mode warm|cold, to standby receivers or new ones]\n"
+         "  [--bench audio, times the audio kernels against plain loops]"
+      << std::endl;
+}
+
+bool parseOptions(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      return false;
+    }
+    std::string value = argv[++i];
+    if (arg == "--senders") {
+      options.senders = std::atoi(value.c_str());
+    } else if (arg == "--receivers") {
+      options.receivers = std::atoi(value.c_str());
+    } else if (arg == "--size") {
+      if (std::sscanf(value.c_str(), "%dx%d", &options.width,
+                      &options.height) != 2) {
+        return false;
+      }
+    } else if (arg == "--fourcc") {
+      auto it = kFourCCs.find(value);
+      if (it == kFourCCs.end()) {
+        return false;
+      }
+      options.fourCC = it->second;
+    } else if (arg == "--fps") {
+      options.frameRateD = 1;
+      if (std::sscanf(value.c_str(), "%d/%d", &options.frameRateN,
+                      &options.frameRateD) < 1) {
+        return false;
+      }
+    } else if (arg == "--audio") {
+      if (std::sscanf(value.c_str(), "%d:%d", &options.sampleRate,
+                      &options.channels) != 2) {
+        return false;
+      }
+    } else if (arg == "--metadata-rate") {
+      options.metadataRate = std::atof(value.c_str());
+    } else if (arg == "--duration") {
+      options.duration = std::atof(value.c_str());
+    } else if (arg == "--group") {
+      options.group = value;
+    } else if (arg == "--library") {
+      options.library = value;
+    } else if (arg == "--connect") {
+      options.connect = value;
+    } else if (arg == "--switch-interval") {
+      options.switchInterval = std::atof(value.c_str());
+    } else if (arg == "--switch-mode") {
+      if (value != "warm" && value != "cold") {
+        return false;
+      }
+      options.switchWarm = value == "warm";
+    } else if (arg == "--bench") {
+      if (value != "audio") {
+        return false;
+      }
+      options.bench = value;
+    } else {
+      return false;
+    }
+  }
+  // receivers without senders have nothing to connect to unless --connect
+  // points them at another process
+  if (options.senders == 0 && options.receivers > 0 &&
+      options.connect.empty() && options.bench.empty()) {
+    return false;
+  }
+  return options.senders >= 0 && options.receivers >= 0 &&
+         options.width > 0 && options.height > 0 && options.frameRateN > 0 &&
+         options.frameRateD > 0 && options.duration > 0 &&
+         options.switchInterval >= 0;
+}
+
+double threadCpuSeconds() {
+  timespec time;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+double processCpuSeconds() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+int lineStride(const Options &options) {
+  switch (options.fourCC) {
+  case NDIlib_FourCC_video_type_BGRA:
+  case NDIlib_FourCC_video_type_BGRX:
+  case NDIlib_FourCC_video_type_RGBA:
+  case NDIlib_FourCC_video_type_RGBX:
+    return options.width * 4;
+  case NDIlib_FourCC_video_type_NV12:
+  case NDIlib_FourCC_video_type_I420:
+    return options.width;
+  default: // UYVY and UYVA, P216 has 16 bit luma so it is the same
+    return options.width * 2;
+  }
+}
+
+/**
+ * @brief sends the frames of one sender at the frame rate until the deadline
+ * @details everything is allocated before the loop, video goes out async from
+ * two buffers that take turns so the sdk compresses one while the next is
+ * stamped
+ */
+SenderResult runSender(NDISender &sender, const Options &options,
+                       Clock::time_point start, Clock::time_point end) {
+  SenderResult result;
+  double cpuStart = threadCpuSeconds();
+
+  NDIlib_video_frame_v2_t video;
+  video.xres = options.width;
+  video.yres = options.height;
+  video.FourCC = options.fourCC;
+  video.frame_rate_N = options.frameRateN;
+  video.frame_rate_D = options.frameRateD;
+  video.line_stride_in_bytes = lineStride(options);
+  size_t videoBytes = FrameRecording::videoPayloadSize(video);
+  std::vector<uint8_t> videoBuffers[2] = {
+      std::vector<uint8_t>(videoBytes, 0x80),
+      std::vector<uint8_t>(videoBytes, 0x80)};
+
+  // the sample counts of consecutive frames differ by one when the rate does
+  // not divide evenly so they add up to the sample rate
+  int64_t samplesPerSecondD =
+      static_cast<int64_t>(options.sampleRate) * options.frameRateD;
+  int maxSamples =
+      static_cast<int>(samplesPerSecondD / options.frameRateN) + 1;
+  std::vector<float> audioBuffer(
+      static_cast<size_t>(maxSamples) * std::max(options.channels, 0));
+  for (size_t i = 0; i < audioBuffer.size(); ++i) {
+    audioBuffer[i] = static_cast<float>(i % 256) / 256.0f - 0.5f;
+  }
+  NDIlib_audio_frame_v2_t audio;
+  audio.sample_rate = options.sampleRate;
+  audio.no_channels = options.channels;
+  audio.p_data = audioBuffer.data();
+
+  const char *metadata = "<ndiw_loadgen/>";
+  auto metadataInterval =
+      options.metadataRate > 0
+          ? std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(1.0 / options.metadataRate))
+          : Clock::duration::max();
+  auto nextMetadata = start;
+
+  for (int64_t frame = 0;; ++frame) {
+    auto deadline = start + std::chrono::duration_cast<Clock::duration>(
+                                std::chrono::duration<double>(
+                                    double(frame) * options.frameRateD /
+                                    options.frameRateN));
+    if (deadline >= end) {
+      break;
+    }
+    auto now = Clock::now();
+    if (now < deadline) {
+      std::this_thread::sleep_until(deadline);
+    } else if (now - deadline > std::chrono::milliseconds(1)) {
+      result.lateFrames++;
+    }
+
+    auto &buffer = videoBuffers[frame % 2];
+    std::memcpy(buffer.data(), &frame, sizeof(frame));
+    video.p_data = buffer.data();
+    sender.feedVideoFrame(video, true);
+    result.videoFrames++;
+    result.bytes += videoBytes;
+
+    if (options.channels > 0) {
+      audio.no_samples = static_cast<int>(
+          (frame + 1) * samplesPerSecondD / options.frameRateN -
+          frame * samplesPerSecondD / options.frameRateN);
+      audio.channel_stride_in_bytes =
+          audio.no_samples * static_cast<int>(sizeof(float));
+      sender.feedAudioFrame(audio);
+      result.audioFrames++;
+      result.bytes += static_cast<uint64_t>(audio.channel_stride_in_bytes) *
+                      audio.no_channels;
+    }
+
+    for (; nextMetadata <= deadline && options.metadataRate > 0;
+         nextMetadata += metadataInterval) {
+      sender.sendRawMetadata(metadata);
+      result.metadataFrames++;
+    }
+  }
+  sender.flushAsync();
+  result.cpuSeconds = threadCpuSeconds() - cpuStart;
+  return result;
+}
+
+/**
+ * @brief waits until the receiver sees the source and connects to it
+ */
+bool connect(NDIReceiver &receiver, const std::string &senderName,
+             std::chrono::seconds timeout) {
+  // the full source name is "HOST (name)"
+  std::string suffix = "(" + senderName + ")";
+  auto deadline = Clock::now() + timeout;
+  while (Clock::now() < deadline) {
+    for (const auto &source : receiver.getCurrentSources()) {
+      if (source.size() >= suffix.size() &&
+          source.compare(source.size() - suffix.size(), suffix.size(),
+                         suffix) == 0) {
+        receiver.setOutput(source);
+        return true;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  return false;
+}
+
+/**
+ * @brief connects to one of the sources whose name contains the pattern, the
+ * index picks which one round robin
+ * @details waits for the first match and then until no new match has shown
+ * up for half a second, so the receivers spread over all the senders of the
+ * other process and not only over the first one found
+ */
+bool connectMatching(NDIReceiver &receiver, const std::string &pattern,
+                     size_t index, std::chrono::seconds timeout) {
+  auto deadline = Clock::now() + timeout;
+  std::vector<std::string> matches;
+  auto settled = Clock::time_point::max();
+  for (auto now = Clock::now(); now < deadline; now = Clock::now()) {
+    std::vector<std::string> current;
+    for (const auto &source : receiver.getCurrentSources()) {
+      if (source.find(pattern) != std::string::npos) {
+        current.push_back(source);
+      }
+    }
+    std::sort(current.begin(), current.end());
+    if (current != matches) {
+      matches = std::move(current);
+      settled = now + std::chrono::milliseconds(500);
+    }
+    if (!matches.empty() && now >= settled) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  if (matches.empty()) {
+    return false;
+  }
+  receiver.setOutput(matches[index % matches.size()]);
+  return true;
+}
+
+/**
+ * @returns the sources of the receiver that belong to the senders it takes,
+ * sorted so every receiver sees them in the same order
+ */
+std::vector<std::string> senderSources(NDIReceiver &receiver,
+                                       const Options &options,
+                                       const std::vector<std::string> &names) {
+  std::vector<std::string> sources;
+  for (const auto &source : receiver.getCurrentSources()) {
+    bool match = false;
+    if (!options.connect.empty()) {
+      match = source.find(options.connect) != std::string::npos;
+    }
+    for (const auto &name : names) {
+      std::string suffix = "(" + name + ")";
+      match = match || (options.connect.empty() &&
+                        source.size() >= suffix.size() &&
+                        source.compare(source.size() - suffix.size(),
+                                       suffix.size(), suffix) == 0);
+    }
+    if (match) {
+      sources.push_back(source);
+    }
+  }
+  std::sort(sources.begin(), sources.end());
+  return sources;
+}
+
+/**
+ * @brief moves every receiver to the next of its sources each interval until
+ * the deadline and records how long setOutput took
+ * @details the receivers start spread over the sources so they do not all
+ * switch to the same one
+ */
+void runSwitches(std::vector<std::unique_ptr<NDIReceiver>> &receivers,
+                 const std::vector<std::vector<std::string>> &sources,
+                 const Options &options, Clock::time_point start,
+                 Clock::time_point end, LatencyHistogram &latency) {
+  auto interval = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(options.switchInterval));
+  for (size_t round = 1;; ++round) {
+    auto due = start + interval * round;
+    if (due >= end) {
+      return;
+    }
+    std::this_thread::sleep_until(due);
+    for (size_t i = 0; i < receivers.size(); ++i) {
+      if (sources[i].size() < 2) {
+        continue;
+      }
+      const std::string &next = sources[i][(i + round) % sources[i].size()];
+      if (receivers[i]->setOutput(next)) {
+        latency.record(receivers[i]->getLastSwitchLatency());
+      }
+    }
+  }
+}
+
+/**
+ * @returns ns per sample of the kernel, runs it for about budget
+ */
+double timeKernel(const std::function<void()> &kernel, size_t samples,
+                  std::chrono::milliseconds budget) {
+  kernel(); // warms the caches and the buffers
+  uint64_t runs = 0;
+  auto start = Clock::now();
+  auto end = start + budget;
+  auto now = start;
+  for (; now < end; now = Clock::now()) {
+    for (int i = 0; i < 64; ++i) {
+      kernel();
+    }
+    runs += 64;
+  }
+  return std::chrono::duration<double, std::nano>(now - start).count() /
+         (double(runs) * samples);
+}
+
+int16_t plainInt16(float sample) {
+  float scaled = std::min(1.0f, std::max(-1.0f, sample)) * 32767.0f;
+  return static_cast<int16_t>(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
+
+/**
+ * @brief times the AudioConversion kernels against the loops a consumer
+ * would write, on one frame of planar float audio with padded planes
+ */
+int benchAudio(const Options &options) {
+  int channels = options.channels > 0 ? options.channels : 2;
+  int samples = static_cast<int>(int64_t(options.sampleRate) *
+                                 options.frameRateD / options.frameRateN);
+  // padding between the planes like a sdk frame with a channel stride
+  int stride = samples + 16;
+  std::vector<float> source(size_t(stride) * channels);
+  for (size_t i = 0; i < source.size(); ++i) {
+    source[i] = std::sin(float(i) * 0.01f) * 1.1f;
+  }
+  std::vector<const float *> planes;
+  for (int c = 0; c < channels; ++c) {
+    planes.push_back(source.data() + size_t(c) * stride);
+  }
+  size_t count = size_t(samples) * channels;
+  std::vector<float> floats(count);
+  std::vector<int16_t> shorts(count);
+  std::vector<uint8_t> bytes(count * 3);
+  const float *const *p = planes.data();
+
+  struct Kernel {
+    const char *name;
+    std::function<void()> library;
+    std::function<void()> plain;
+  };
+  std::vector<Kernel> kernels = {
+      {"interleave float",
+       [&]() {
+         AudioConversion::interleave(p, channels, samples, floats.data());
+       },
+       [&]() {
+         for (int s = 0; s < samples; ++s) {
+           for (int c = 0; c < channels; ++c) {
+             floats[size_t(s) * channels + c] = p[c][s];
+           }
+         }
+       }},
+      {"interleave int16",
+       [&]() {
+         AudioConversion::interleaveToInt16(p, channels, samples,
+                                            shorts.data());
+       },
+       [&]() {
+         for (int s = 0; s < samples; ++s) {
+           for (int c = 0; c < channels; ++c) {
+             shorts[size_t(s) * channels + c] = plainInt16(p[c][s]);
+           }
+         }
+       }},
+      {"float to int16",
+       [&]() {
+         AudioConversion::floatToInt16(source.data(), count, shorts.data());
+       },
+       [&]() {
+         for (size_t i = 0; i < count; ++i) {
+           shorts[i] = plainInt16(source[i]);
+         }
+       }},
+      {"interleave int24",
+       [&]() {
+         AudioConversion::interleaveToInt24(p, channels, samples,
+                                            bytes.data());
+       },
+       [&]() {
+         for (int s = 0; s < samples; ++s) {
+           for (int c = 0; c < channels; ++c) {
+             float scaled =
+                 std::min(1.0f, std::max(-1.0f, p[c][s])) * 8388607.0f;
+             int32_t value = static_cast<int32_t>(
+                 scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+             uint8_t *dst = bytes.data() + (size_t(s) * channels + c) * 3;
+             dst[0] = static_cast<uint8_t>(value);
+             dst[1] = static_cast<uint8_t>(value >> 8);
+             dst[2] = static_cast<uint8_t>(value >> 16);
+           }
+         }
+       }},
+  };
+
+  std::printf("audio kernels, %d channels x %d samples per frame\n", channels,
+              samples);
+  std::printf("%-18s %12s %12s %8s\n", "", "kernel ns", "plain ns",
+              "speedup");
+  const auto budget = std::chrono::milliseconds(300);
+  for (const auto &kernel : kernels) {
+    double library = timeKernel(kernel.library, count, budget);
+    double plain = timeKernel(kernel.plain, count, budget);
+    std::printf("%-18s %12.3f %12.3f %7.2fx\n", kernel.name, library, plain,
+                plain / library);
+  }
+  return 0;
+}
+
+void printHistogram(const char *name, const LatencyHistogram::Snapshot &h) {
+  std::printf("%-28s n=%llu mean=%.0f p50<=%llu p90<=%llu p99<=%llu "
+              "max=%llu us\n",
+              name, static_cast<unsigned long long>(h.count), h.meanUs(),
+              static_cast<unsigned long long>(h.quantileUs(0.5)),
+              static_cast<unsigned long long>(h.quantileUs(0.9)),
+              static_cast<unsigned long long>(h.quantileUs(0.99)),
+              static_cast<unsigned long long>(h.maxUs));
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  if (options.bench == "audio") {
+    return benchAudio(options);
+  }
+  if (!options.library.empty()) {
+    setenv("NDIWRAPPER_NDI_LIBRARY", options.library.c_str(), 1);
+  }
+
+  try {
+    // the receivers share the callback pool of the factory, which runs the
+    // callbacks still queued when it is destroyed, so whatever the callbacks
+    // write to is declared before the factory and outlives it
+    std::vector<std::unique_ptr<ReceiverCounters>> counters;
+    LatencyHistogram latency;
+    auto factoryStart = Clock::now();
+    NDIEndpointFactory factory;
+    factory.warmDiscovery(options.group);
+    auto factoryTime = Clock::now() - factoryStart;
+
+    std::vector<std::string> names;
+    for (int i = 0; i < options.senders; ++i) {
+      names.push_back("ndiw-loadgen-" + std::to_string(i));
+    }
+    // every endpoint is queued before waiting for any so they are created
+    // side by side on the factory threads
+    auto createStart = Clock::now();
+    // the senders are paced here, clocking in the sdk would add to it
+    auto senderFutures =
+        factory.createSenders(names, options.group, false, false);
+    std::vector<std::future<std::unique_ptr<NDIReceiver>>> receiverFutures;
+    for (int i = 0; i < options.receivers; ++i) {
+      receiverFutures.push_back(factory.createReceiver(options.group));
+    }
+    std::vector<std::unique_ptr<NDISender>> senders;
+    for (auto &future : senderFutures) {
+      senders.push_back(future.get());
+    }
+    std::vector<std::unique_ptr<NDIReceiver>> receivers;
+    for (auto &future : receiverFutures) {
+      receivers.push_back(future.get());
+    }
+    auto parallelTime = Clock::now() - createStart;
+
+    // the same endpoints one after another for comparison, under other names
+    // so no receiver connects to them
+    auto sequentialStart = Clock::now();
+    {
+      std::vector<std::unique_ptr<NDISender>> sequentialSenders;
+      for (int i = 0; i < options.senders; ++i) {
+        sequentialSenders.push_back(std::make_unique<NDISender>(
+            "ndiw-startup-" + std::to_string(i), options.group, false, false,
+            factory.callbackPool()));
+      }
+      std::vector<std::unique_ptr<NDIReceiver>> sequentialReceivers;
+      for (int i = 0; i < options.receivers; ++i) {
+        sequentialReceivers.push_back(std::make_unique<NDIReceiver>(
+            options.group, true, false, NDIlib_recv_bandwidth_highest,
+            factory.callbackPool()));
+      }
+    }
+    auto sequentialTime = Clock::now() - sequentialStart;
+
+    for (size_t i = 0; i < receivers.size(); ++i) {
+      counters.push_back(std::make_unique<ReceiverCounters>());
+      NDIReceiver &receiver = *receivers[i];
+      ReceiverCounters &counter = *counters.back();
+      receiver.addFrameCallback([&counter, &latency](Image image) {
+        counter.videoFrames.fetch_add(1, std::memory_order_relaxed);
+        counter.bytes.fetch_add(image.data.size(), std::memory_order_relaxed);
+        // the timestamp is in ns since the epoch, set by the sending sdk
+        int64_t now =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch())
+                .count();
+        if (image.timestamp > 0 && image.timestamp <= now) {
+          latency.record(std::chrono::nanoseconds(now - image.timestamp));
+        }
+      });
+      receiver.addAudioCallback([&counter](Audio audio) {
+        counter.audioFrames.fetch_add(1, std::memory_order_relaxed);
+        counter.bytes.fetch_add(audio.data.size() * sizeof(float),
+                                std::memory_order_relaxed);
+      });
+      receiver.addRawMetadataCallback(
+          [&counter](std::string_view, int64_t) {
+            counter.metadataFrames.fetch_add(1, std::memory_order_relaxed);
+          });
+      receiver.start();
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < receivers.size(); ++i) {
+      if (!options.connect.empty()) {
+        if (!connectMatching(*receivers[i], options.connect, i,
+                             std::chrono::seconds(10))) {
+          std::cerr << "receiver " << i << " found no source containing "
+                    << options.connect << std::endl;
+          ok = false;
+        }
+        continue;
+      }
+      const std::string &name = names[i % names.size()];
+      if (!connect(*receivers[i], name, std::chrono::seconds(10))) {
+        std::cerr << "receiver " << i << " did not find " << name
+                  << std::endl;
+        ok = false;
+      }
+    }
+
+    // every source of the senders is kept warm on every receiver that
+    // switches, the standbys connect before the clock starts
+    std::vector<std::vector<std::string>> switchSources(receivers.size());
+    LatencyHistogram switchLatency;
+    if (options.switchInterval > 0) {
+      for (size_t i = 0; i < receivers.size(); ++i) {
+        switchSources[i] = senderSources(*receivers[i], options, names);
+        if (switchSources[i].size() < 2) {
+          std::cerr << "receiver " << i << " has fewer than 2 sources to "
+                    << "switch between" << std::endl;
+        } else if (options.switchWarm) {
+          receivers[i]->setStandbySources(switchSources[i]);
+        }
+      }
+    }
+
+    double processCpuStart = processCpuSeconds();
+    auto start = Clock::now() + std::chrono::milliseconds(100);
+    auto end = start + std::chrono::duration_cast<Clock::duration>(
+                           std::chrono::duration<double>(options.duration));
+    std::vector<SenderResult> results(senders.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < senders.size(); ++i) {
+      threads.emplace_back([&, i]() {
+        results[i] = runSender(*senders[i], options, start, end);
+      });
+    }
+    if (options.switchInterval > 0) {
+      threads.emplace_back([&]() {
+        runSwitches(receivers, switchSources, options, start, end,
+                    switchLatency);
+      });
+    }
+    std::this_thread::sleep_until(end);
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    double elapsed =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    double processCpu = processCpuSeconds() - processCpuStart;
+
+    SenderResult sent;
+    for (const auto &result : results) {
+      sent.videoFrames += result.videoFrames;
+      sent.audioFrames += result.audioFrames;
+      sent.metadataFrames += result.metadataFrames;
+      sent.bytes += result.bytes;
+      sent.lateFrames += result.lateFrames;
+      sent.cpuSeconds += result.cpuSeconds;
+    }
+    uint64_t receivedVideo = 0, receivedAudio = 0, receivedMetadata = 0;
+    uint64_t receivedBytes = 0, dropped = 0;
+    LatencyHistogram::Snapshot callbackLatency;
+    for (size_t i = 0; i < receivers.size(); ++i) {
+      receivedVideo += counters[i]->videoFrames;
+      receivedAudio += counters[i]->audioFrames;
+      receivedMetadata += counters[i]->metadataFrames;
+      receivedBytes += counters[i]->bytes;
+      EndpointStatsSnapshot stats = receivers[i]->getStats();
+      dropped += stats.droppedVideoFrames;
+      const auto &histogram = stats.callbackLatency;
+      for (size_t b = 0; b < LatencyHistogram::kBuckets; ++b) {
+        callbackLatency.buckets[b] += histogram.buckets[b];
+      }
+      callbackLatency.count += histogram.count;
+      callbackLatency.sumUs += histogram.sumUs;
+      callbackLatency.maxUs = std::max(callbackLatency.maxUs, histogram.maxUs);
+    }
+
+    std::printf("%d senders, %d receivers, %dx%d @ %d/%d, %.1f s\n",
+                options.senders, options.receivers, options.width,
+                options.height, options.frameRateN, options.frameRateD,
+                elapsed);
+    using Ms = std::chrono::duration<double, std::milli>;
+    NDILibraryManager::Stats runtime = NDILibraryManager::GetStats();
+    std::printf("startup   runtime load %.1f ms, initialize %.1f ms, "
+                "factory %.1f ms, %d endpoints %.1f ms on the factory, "
+                "%.1f ms one after another\n",
+                Ms(runtime.loadTime).count(),
+                Ms(runtime.initializeTime).count(), Ms(factoryTime).count(),
+                options.senders + options.receivers,
+                Ms(parallelTime).count(), Ms(sequentialTime).count());
+    std::printf("sent      video %llu (%.1f fps), audio %llu, metadata "
+                "%llu, %.1f MB/s, %llu late\n",
+                static_cast<unsigned long long>(sent.videoFrames),
+                sent.videoFrames / elapsed,
+                static_cast<unsigned long long>(sent.audioFrames),
+                static_cast<unsigned long long>(sent.metadataFrames),
+                sent.bytes / elapsed / 1e6,
+                static_cast<unsigned long long>(sent.lateFrames));
+    std::printf("received  video %llu (%.1f fps), audio %llu, metadata "
+                "%llu, %.1f MB/s, %llu dropped\n",
+                static_cast<unsigned long long>(receivedVideo),
+                receivedVideo / elapsed,
+                static_cast<unsigned long long>(receivedAudio),
+                static_cast<unsigned long long>(receivedMetadata),
+                receivedBytes / elapsed / 1e6,
+                static_cast<unsigned long long>(dropped));
+    // only the feed threads of the senders can be timed on their own, the
+    // sdk compresses and sends on its own threads. So the process cpu per
+    // stream is per sender or per receiver only when the process runs one
+    // side, with both it is the mean over all the endpoints
+    double feedCpu = options.senders > 0
+                         ? sent.cpuSeconds / options.senders / elapsed
+                         : 0;
+    int streams = options.senders + options.receivers;
+    double streamCpu = streams > 0 ? processCpu / streams / elapsed : 0;
+    const char *stream = options.receivers == 0 ? "sender"
+                         : options.senders == 0 ? "receiver"
+                                                : "endpoint";
+    std::printf("cpu       %.1f%% per sender feed thread, %.1f%% per %s, "
+                "%.1f%% process\n",
+                feedCpu * 100, streamCpu * 100, stream,
+                processCpu / elapsed * 100);
+    printHistogram("send to callback latency", latency.snapshot());
+    printHistogram("capture to callback latency", callbackLatency);
+    if (options.switchInterval > 0) {
+      printHistogram(options.switchWarm ? "warm switch latency"
+                                        : "cold switch latency",
+                     switchLatency.snapshot());
+    }
+
+    if (!receivers.empty() && receivedVideo == 0) {
+      std::cerr << "no video was received" << std::endl;
+      ok = false;
+    }
+
+    for (auto &receiver : receivers) {
+      receiver->stop();
+    }
+    if (!ok) {
+      return 1;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,67 @@
+#include "FrameReplayer.hpp"
+#include "NDISender.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+/**
+ * @brief plays a recording made by FrameRecorder as a ndi source
+ * @details usage: NDIReplay <recording> <source name> [--group name]
+ * [--speed x] [--loop] [--no-video] [--no-audio] [--no-metadata]
+ * speed 0 sends the frames as fast as the sender takes them
+ */
+namespace {
+void printUsage() {
+  std::cerr << "usage: NDIReplay <recording> <source name> [--group name] "
+               "[--speed x] [--loop] [--no-video] [--no-audio] "
+               "[--no-metadata]"
+            << std::endl;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    printUsage();
+    return 1;
+  }
+  std::string path = argv[1];
+  std::string name = argv[2];
+  std::string group;
+  FrameReplayer::Options options;
+  for (int i = 3; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--group" && i + 1 < argc) {
+      group = argv[++i];
+    } else if (arg == "--speed" && i + 1 < argc) {
+      options.speed = std::atof(argv[++i]);
+    } else if (arg == "--loop") {
+      options.loop = true;
+    } else if (arg == "--no-video") {
+      options.video = false;
+    } else if (arg == "--no-audio") {
+      options.audio = false;
+    } else if (arg == "--no-metadata") {
+      options.metadata = false;
+    } else {
+      printUsage();
+      return 1;
+    }
+  }
+
+  try {
+    // the replayer does the timing, clocking in the sdk would slow it down
+    auto sender = std::make_shared<NDISender>(name, group, false, false);
+    FrameReplayer replayer(path, sender, options);
+    std::cout << "Playing " << replayer.frameCount() << " frames, "
+              << replayer.duration() / 10000 << " ms as " << name
+              << std::endl;
+    replayer.run();
+    std::cout << "Sent " << replayer.framesSent() << " frames" << std::endl;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}